@@ -0,0 +1,120 @@
+#include "bot.h"
+
+#include "config.h"
+#include "profile.h"
+
+bool bot_init(Bot *bot, Game *game)
+{
+	bot->turning = STILL;
+	return query_init(&bot->index, game);
+}
+
+void bot_free(Bot *bot)
+{
+	query_free(&bot->index);
+}
+
+/**
+ * Holds the key that turns the ship one way, or none.
+ */
+static void bot_turn(Bot *bot, Game *game, DirectionState turning)
+{
+	if (turning == bot->turning) {
+		return;
+	}
+	if (turning == STILL) {
+		game_input(game, (bot->turning == CLOCKWISE) ? INPUT_RIGHT : INPUT_LEFT, false, game->time);
+	} else {
+		game_input(game, (turning == CLOCKWISE) ? INPUT_RIGHT : INPUT_LEFT, true, game->time);
+	}
+	bot->turning = turning;
+}
+
+void bot_play(Bot *bot, Game *game)
+{
+	PROFILE_FUNCTION();
+	Player *player = game->player;
+	float x = REAL_FLOAT(player->x);
+	float y = REAL_FLOAT(player->y);
+	QueryHit around[BOT_TARGETS];
+	QueryHit target = { 0 }, ahead;
+	float target_dx = 0, target_dy = 0;
+	float soonest = SDL_MAX_SINT32;
+	bool found = false;
+
+	query_update(&bot->index, game);
+	const QuerySnapshot *snapshot = query_acquire(&bot->index);
+
+	/* The asteroid around that comes within the margin the soonest */
+	int n = SDL_min(query_radius(snapshot, player->x, player->y, REAL(BOT_WATCH), BOT_TARGETS,
+								 around),
+					BOT_TARGETS);
+	for (int i = 0; i < n; i++) {
+		Asteroid asteroid = asteroid_get(game, store_find(&game->asteroids, around[i].handle));
+		float px = REAL_FLOAT(around[i].x) - x;
+		float py = REAL_FLOAT(around[i].y) - y;
+		float dx = REAL_FLOAT(asteroid.dx);
+		float dy = REAL_FLOAT(asteroid.dy);
+		float speed_sq = dx * dx + dy * dy;
+		float closest = (speed_sq > 0) ? SDL_max(-(px * dx + py * dy) / speed_sq, 0) : 0;
+		float miss_x = px + dx * closest;
+		float miss_y = py + dy * closest;
+		float clearance = SHIP_RADIUS + REAL_FLOAT(around[i].radius) + BOT_MARGIN;
+
+		if (miss_x * miss_x + miss_y * miss_y < clearance * clearance && closest < soonest) {
+			target = around[i];
+			target_dx = dx;
+			target_dy = dy;
+			soonest = closest;
+			found = true;
+		}
+	}
+	/* Nothing is coming, clear the field from the closest one out */
+	if (!found && query_nearest(snapshot, player->x, player->y, 1, &target) == 1) {
+		Asteroid asteroid = asteroid_get(game, store_find(&game->asteroids, target.handle));
+		target_dx = REAL_FLOAT(asteroid.dx);
+		target_dy = REAL_FLOAT(asteroid.dy);
+		found = true;
+	}
+
+	/* Whatever lies straight ahead is worth a shot too */
+	Real heading_x = real_sin(player->direction);
+	Real heading_y = -real_cos(player->direction);
+	bool clear_shot = query_ray(snapshot, player->x, player->y, heading_x, heading_y,
+								REAL(BOT_WATCH), &ahead);
+	query_release(&bot->index, snapshot);
+
+	if (!found) {
+		bot_turn(bot, game, STILL);
+		return;
+	}
+
+	/* Where the asteroid will be by the time a bullet gets there, a few times over */
+	float aim_x = REAL_FLOAT(target.x) - x;
+	float aim_y = REAL_FLOAT(target.y) - y;
+	for (int i = 0; i < 3; i++) {
+		float flight = SDL_sqrtf(aim_x * aim_x + aim_y * aim_y) / BULLET_VELOCITY;
+		aim_x = REAL_FLOAT(target.x) - x + target_dx * flight;
+		aim_y = REAL_FLOAT(target.y) - y + target_dy * flight;
+	}
+
+	/* Directions go clockwise from straight up, in degrees */
+	float aim = (float)(SDL_atan2(aim_x, -aim_y) * 180 / SDL_PI_D);
+	float off = SDL_fmodf(aim - (float)player->direction + 540, 360) - 180;
+	if (off > ROTATION_SPEED / 2.0f) {
+		bot_turn(bot, game, CLOCKWISE);
+	} else if (off < -ROTATION_SPEED / 2.0f) {
+		bot_turn(bot, game, COUNTER_CLOCKWISE);
+	} else {
+		bot_turn(bot, game, STILL);
+	}
+
+	if ((SDL_fabsf(off) <= ROTATION_SPEED || clear_shot) && game->bullets.count < MAX_BULLETS) {
+		game_input(game, INPUT_FIRE, true, game->time);
+	}
+}
+
+void bot_stop(Bot *bot, Game *game)
+{
+	bot_turn(bot, game, STILL);
+}
@@ -0,0 +1,65 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include <stdbool.h>
+
+#include "game.h"
+#include "query.h"
+
+/**
+ * @brief Distance around the ship the bot watches for asteroids on a collision course
+ */
+#define BOT_WATCH 600
+/**
+ * @brief Asteroids around the ship the bot weighs at most
+ */
+#define BOT_TARGETS 32
+/**
+ * @brief Room the bot wants between the ship and an asteroid passing by
+ */
+#define BOT_MARGIN 40
+
+/**
+ * An autopilot for the ship. It stays where it is, turns towards the asteroid that will come
+ * closest soonest, or else the nearest one, and fires where it will be once the bullet gets there.
+ * It looks at the asteroids through the spatial queries and plays through game_input(), like the
+ * keyboard does.
+ */
+typedef struct {
+	QueryIndex index;		/**< Where the asteroids are */
+	DirectionState turning; /**< Turn key held */
+} Bot;
+
+/**
+ * Starts a bot for a game.
+ *
+ * @param bot The bot to initialize
+ * @param game The game it plays
+ * @return True if it could be started, false otherwise
+ */
+bool bot_init(Bot *bot, Game *game);
+
+/**
+ * Frees what the bot allocated.
+ *
+ * @param bot The bot to free
+ */
+void bot_free(Bot *bot);
+
+/**
+ * Looks at the game and queues the inputs for its next tick.
+ *
+ * @param bot The bot
+ * @param game The game, with time set to that of its next tick
+ */
+void bot_play(Bot *bot, Game *game);
+
+/**
+ * Lets go of every key the bot holds, to hand the ship back to the player.
+ *
+ * @param bot The bot
+ * @param game The game
+ */
+void bot_stop(Bot *bot, Game *game);
+
+#endif	// !BOT_H
@@ -0,0 +1,182 @@
+#include "capture.h"
+
+#include <stdlib.h>
+
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_pixels.h>
+#include <SDL3/SDL_surface.h>
+
+#include "churn.h"
+#include "config.h"
+#include "profile.h"
+
+/**
+ * Writes the queued frames until told to stop, and then the ones still queued.
+ */
+static int SDLCALL capture_writer(void *data)
+{
+	Capture *capture = data;
+
+	SDL_LockMutex(capture->lock);
+	for (;;) {
+		while (capture->queued == 0 && !capture->stopping) {
+			SDL_WaitCondition(capture->ready, capture->lock);
+		}
+		if (capture->queued == 0) {
+			break;
+		}
+
+		/* The game doesn't touch queued buffers, no need to hold the lock while writing */
+		Uint8 *frame = capture->buffers[capture->head];
+		bool failed = capture->failed;
+		SDL_UnlockMutex(capture->lock);
+		if (!failed) {
+			PROFILE_ZONE("capture write");
+			if (fputs("FRAME\n", capture->file) < 0
+				|| fwrite(frame, capture->frame_size, 1, capture->file) != 1) {
+				SDL_Log("capture: couldn't write frame, dropping the next ones");
+				failed = true;
+			} else {
+				capture->written++;
+			}
+		}
+		SDL_LockMutex(capture->lock);
+
+		capture->failed = failed;
+		capture->head = (capture->head + 1) % CAPTURE_BUFFERS;
+		capture->queued--;
+	}
+	SDL_UnlockMutex(capture->lock);
+
+	return 0;
+}
+
+bool capture_start(Capture *capture, const char *path, int width, int height)
+{
+	SDL_zerop(capture);
+	capture->width = width;
+	capture->height = height;
+	/* A full resolution luma plane and two quarter resolution chroma planes */
+	capture->frame_size
+	  = (size_t)width * height + 2 * (size_t)((width + 1) / 2) * ((height + 1) / 2);
+
+	for (int i = 0; i < CAPTURE_BUFFERS; i++) {
+		capture->buffers[i] = malloc(capture->frame_size);
+		if (!capture->buffers[i]) {
+			SDL_Log("Couldn't allocate memory: %s", SDL_GetError());
+			goto fail;
+		}
+	}
+	capture->lock = SDL_CreateMutex();
+	capture->ready = SDL_CreateCondition();
+	if (!capture->lock || !capture->ready) {
+		SDL_Log("Couldn't create capture lock: %s", SDL_GetError());
+		goto fail;
+	}
+
+	capture->file = fopen(path, "wb");
+	if (!capture->file) {
+		SDL_Log("Couldn't open %s", path);
+		goto fail;
+	}
+	/* SDL converts to limited range BT.601, with chroma sited between the luma samples */
+	fprintf(capture->file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n",
+			width, height, FPS);
+
+	capture->writer = SDL_CreateThread(capture_writer, "capture", capture);
+	if (!capture->writer) {
+		SDL_Log("Couldn't create capture thread: %s", SDL_GetError());
+		goto fail;
+	}
+	SDL_Log("capture: recording %dx%d to %s", width, height, path);
+	return true;
+
+fail:
+	if (capture->file) {
+		fclose(capture->file);
+	}
+	SDL_DestroyCondition(capture->ready);
+	SDL_DestroyMutex(capture->lock);
+	for (int i = 0; i < CAPTURE_BUFFERS; i++) {
+		free(capture->buffers[i]);
+	}
+	SDL_zerop(capture);
+	return false;
+}
+
+void capture_frame(Capture *capture, SDL_Renderer *renderer)
+{
+	PROFILE_FUNCTION();
+	CHURN_SITE("capture");
+	SDL_Surface *surface;
+	Uint8 *frame;
+	bool full, failed;
+
+	SDL_LockMutex(capture->lock);
+	full = capture->queued == CAPTURE_BUFFERS;
+	failed = capture->failed;
+	frame = capture->buffers[(capture->head + capture->queued) % CAPTURE_BUFFERS];
+	SDL_UnlockMutex(capture->lock);
+	/* Checked before reading back, so a slow disk doesn't cost the readback either */
+	if (failed) {
+		capture->errors++;
+		return;
+	}
+	if (full) {
+		capture->dropped++;
+		return;
+	}
+
+	surface = SDL_RenderReadPixels(renderer, NULL);
+	if (!surface) {
+		SDL_Log("capture: couldn't read frame: %s", SDL_GetError());
+		capture->errors++;
+		return;
+	}
+	if (surface->w != capture->width || surface->h != capture->height) {
+		SDL_DestroySurface(surface);
+		capture->resized++;
+		return;
+	}
+	if (!SDL_ConvertPixels(surface->w, surface->h, surface->format, surface->pixels,
+						   surface->pitch, SDL_PIXELFORMAT_IYUV, frame, capture->width)) {
+		SDL_Log("capture: couldn't convert frame: %s", SDL_GetError());
+		SDL_DestroySurface(surface);
+		capture->errors++;
+		return;
+	}
+	SDL_DestroySurface(surface);
+
+	SDL_LockMutex(capture->lock);
+	capture->queued++;
+	SDL_SignalCondition(capture->ready);
+	SDL_UnlockMutex(capture->lock);
+}
+
+void capture_stop(Capture *capture)
+{
+	if (!capture->writer) {
+		return;
+	}
+
+	SDL_LockMutex(capture->lock);
+	capture->stopping = true;
+	SDL_SignalCondition(capture->ready);
+	SDL_UnlockMutex(capture->lock);
+	SDL_WaitThread(capture->writer, NULL);
+
+	if (fclose(capture->file) != 0) {
+		SDL_Log("capture: couldn't close the video");
+	}
+	SDL_Log("capture: %llu frames written, %llu dropped because the disk fell behind, %llu "
+			"because the window was resized, %llu lost to errors",
+			(unsigned long long)capture->written, (unsigned long long)capture->dropped,
+			(unsigned long long)capture->resized, (unsigned long long)capture->errors);
+
+	SDL_DestroyCondition(capture->ready);
+	SDL_DestroyMutex(capture->lock);
+	for (int i = 0; i < CAPTURE_BUFFERS; i++) {
+		free(capture->buffers[i]);
+	}
+	SDL_zerop(capture);
+}
@@ -0,0 +1,76 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <SDL3/SDL_mutex.h>
+#include <SDL3/SDL_render.h>
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_thread.h>
+
+/**
+ * Records every frame shown into a Y4M video, without slowing the game down.
+ *
+ * Frames are read back from the renderer and converted to YUV 4:2:0 straight into one of a few
+ * buffers allocated up front. A writer thread streams the queued buffers to the file and hands
+ * them back. When the disk falls behind and every buffer is queued, frames are dropped and
+ * counted instead of waiting for it.
+ */
+
+/**
+ * @brief Buffers frames are read into, the most frames waiting for the disk at any time
+ */
+#define CAPTURE_BUFFERS 8
+
+/**
+ * A recording in progress.
+ */
+typedef struct {
+	FILE* file;						 /**< The video being written */
+	int width;						 /**< Width of the video, frames of other sizes are skipped */
+	int height;						 /**< Height of the video */
+	size_t frame_size;				 /**< Bytes of a frame */
+	Uint8* buffers[CAPTURE_BUFFERS]; /**< Frames, used as a ring */
+	int head;						 /**< Oldest frame waiting to be written */
+	int queued;						 /**< Frames waiting to be written */
+	bool stopping;					 /**< Whether the writer stops once the queue is empty */
+	bool failed;					 /**< Whether writing failed. Later frames are dropped. */
+	SDL_Mutex* lock;				 /**< Protects head, queued, stopping and failed */
+	SDL_Condition* ready;			 /**< Signalled when a frame is queued, or when stopping */
+	SDL_Thread* writer;				 /**< Thread writing the queued frames */
+	Uint64 written;					 /**< Frames written, only touched by the writer */
+	Uint64 dropped;					 /**< Frames dropped because every buffer was queued */
+	Uint64 resized;					 /**< Frames dropped because the window size changed */
+	Uint64 errors;					 /**< Frames lost to a failed write, readback or conversion */
+} Capture;
+
+/**
+ * Creates the video and starts the writer thread.
+ *
+ * @param capture The recording to start
+ * @param path Video file to write
+ * @param width Width of the frames, in pixels
+ * @param height Height of the frames, in pixels
+ * @return True if it started, false otherwise
+ */
+bool capture_start(Capture *capture, const char *path, int width, int height);
+
+/**
+ * Records the frame that is about to be presented. Must be called right before
+ * SDL_RenderPresent(), the contents of the frame are gone after it.
+ *
+ * @param capture The recording
+ * @param renderer Renderer the frame was drawn with
+ */
+void capture_frame(Capture *capture, SDL_Renderer *renderer);
+
+/**
+ * Waits for the queued frames to be written, closes the video and logs how many frames were
+ * written and dropped.
+ *
+ * @param capture The recording to stop
+ */
+void capture_stop(Capture *capture);
+
+#endif	// !CAPTURE_H
@@ -0,0 +1,248 @@
+#include "churn.h"
+
+#ifdef CHURN
+
+#include <SDL3/SDL_atomic.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_stdinc.h>
+
+/**
+ * Everything counted for a call site. The frame counts are added to by any thread, and moved to
+ * the totals by the main thread at the end of every frame.
+ */
+typedef struct {
+	const char *name;			  /**< Name of the site */
+	SDL_AtomicInt allocations;	  /**< Allocations this frame, reallocations included */
+	SDL_AtomicInt bytes;		  /**< Bytes asked for this frame */
+	SDL_AtomicInt frees;		  /**< Frees this frame */
+	SDL_AtomicInt created;		  /**< Textures created this frame */
+	SDL_AtomicInt destroyed;	  /**< Textures destroyed this frame */
+	Uint64 total_allocations;	  /**< Allocations since the start */
+	Uint64 total_bytes;			  /**< Bytes asked for since the start */
+	Uint64 total_frees;			  /**< Frees since the start */
+	Uint64 total_created;		  /**< Textures created since the start */
+	Uint64 total_destroyed;		  /**< Textures destroyed since the start */
+	Uint64 steady_frames;		  /**< Frames past the warm up it allocated in */
+} ChurnSite;
+
+/**
+ * Every site, "other" first
+ */
+static ChurnSite sites[CHURN_MAX_SITES] = { { .name = "other" } };
+/**
+ * Number of sites
+ */
+static SDL_AtomicInt n_sites = { 1 };
+/**
+ * Serializes adding sites
+ */
+static SDL_SpinLock sites_lock;
+/**
+ * Site the calling thread allocates for
+ */
+static _Thread_local int current;
+/**
+ * Set while the tracker logs, so that its own allocations aren't counted
+ */
+static _Thread_local bool muted;
+/**
+ * Frames ended
+ */
+static Uint64 frames;
+/**
+ * Frames past the warm up that allocated or created textures
+ */
+static Uint64 steady_frames;
+/**
+ * Such frames since the last one reported
+ */
+static Uint64 unreported;
+/**
+ * Frame the last report was about
+ */
+static Uint64 last_report;
+
+/**
+ * The allocator SDL had before
+ */
+static SDL_malloc_func real_malloc;
+static SDL_calloc_func real_calloc;
+static SDL_realloc_func real_realloc;
+static SDL_free_func real_free;
+
+/**
+ * Counts an allocation to the current site.
+ */
+static void churn_count(size_t size)
+{
+	if (muted)
+		return;
+	SDL_AddAtomicInt(&sites[current].allocations, 1);
+	SDL_AddAtomicInt(&sites[current].bytes, (int)size);
+}
+
+static void *SDLCALL churn_malloc(size_t size)
+{
+	churn_count(size);
+	return real_malloc(size);
+}
+
+static void *SDLCALL churn_calloc(size_t count, size_t size)
+{
+	churn_count(count * size);
+	return real_calloc(count, size);
+}
+
+static void *SDLCALL churn_realloc(void *mem, size_t size)
+{
+	churn_count(size);
+	return real_realloc(mem, size);
+}
+
+static void SDLCALL churn_free(void *mem)
+{
+	/* Sizes aren't kept, so pointers allocated before churn_init() can be freed too */
+	if (mem && !muted)
+		SDL_AddAtomicInt(&sites[current].frees, 1);
+	real_free(mem);
+}
+
+bool churn_init(void)
+{
+	SDL_GetMemoryFunctions(&real_malloc, &real_calloc, &real_realloc, &real_free);
+	if (!SDL_SetMemoryFunctions(churn_malloc, churn_calloc, churn_realloc, churn_free)) {
+		SDL_Log("Couldn't count allocations: %s", SDL_GetError());
+		return false;
+	}
+	return true;
+}
+
+int churn_site_begin(const char *name)
+{
+	int previous = current;
+	int n = SDL_GetAtomicInt(&n_sites);
+	int site;
+
+	/* Names are literals, the same site always passes the same pointer */
+	for (site = 0; site < n && sites[site].name != name; site++)
+		;
+	if (site == n) {
+		SDL_LockSpinlock(&sites_lock);
+		n = SDL_GetAtomicInt(&n_sites);
+		for (site = 0; site < n && sites[site].name != name; site++)
+			;
+		if (site == n && n < CHURN_MAX_SITES) {
+			sites[n].name = name;
+			SDL_SetAtomicInt(&n_sites, n + 1);
+		} else if (site == n) {
+			site = 0;
+		}
+		SDL_UnlockSpinlock(&sites_lock);
+	}
+	current = site;
+
+	return previous;
+}
+
+void churn_site_end(int *previous)
+{
+	current = *previous;
+}
+
+void churn_texture(bool created)
+{
+	SDL_AddAtomicInt(created ? &sites[current].created : &sites[current].destroyed, 1);
+}
+
+/**
+ * Moves the counts of the frame into the totals.
+ *
+ * @param steady Whether the frame is past the warm up, and counts as a steady frame
+ * @param report Where to describe the sites that allocated, if steady
+ * @param size Size of report
+ * @return True if the frame is steady and allocated or created textures, false otherwise
+ */
+static bool churn_collect(bool steady, char *report, int size)
+{
+	int n = SDL_GetAtomicInt(&n_sites);
+	bool churned = false;
+	int length = 0;
+
+	for (int i = 0; i < n; i++) {
+		ChurnSite *site = &sites[i];
+		int allocations = SDL_SetAtomicInt(&site->allocations, 0);
+		int bytes = SDL_SetAtomicInt(&site->bytes, 0);
+		int created = SDL_SetAtomicInt(&site->created, 0);
+
+		site->total_allocations += allocations;
+		site->total_bytes += (Uint32)bytes;
+		site->total_frees += SDL_SetAtomicInt(&site->frees, 0);
+		site->total_created += created;
+		site->total_destroyed += SDL_SetAtomicInt(&site->destroyed, 0);
+		if (!steady || (allocations == 0 && created == 0))
+			continue;
+
+		site->steady_frames++;
+		churned = true;
+		if (length < size) {
+			length += SDL_snprintf(report + length, size - length,
+								   "%s%s %d allocations (%d bytes) %d textures",
+								   length ? ", " : "", site->name, allocations, bytes, created);
+		}
+	}
+
+	return churned;
+}
+
+void churn_frame(void)
+{
+	char report[512];
+
+	frames++;
+	if (!churn_collect(frames > CHURN_WARMUP_FRAMES, report, sizeof(report)))
+		return;
+
+	steady_frames++;
+	unreported++;
+	if (last_report == 0 || frames - last_report >= CHURN_REPORT_INTERVAL) {
+		muted = true;
+		SDL_Log("churn: frame %llu allocated: %s (%llu such frames since the last report)",
+				(unsigned long long)frames, report, (unsigned long long)unreported);
+		muted = false;
+		last_report = frames;
+		unreported = 0;
+	}
+}
+
+void churn_dump(void)
+{
+	int n = SDL_GetAtomicInt(&n_sites);
+	Uint64 created = 0, destroyed = 0;
+
+	/* Whatever happened since the last frame, shutting down isn't a steady frame */
+	churn_collect(false, NULL, 0);
+
+	muted = true;
+	SDL_Log("churn: %llu frames, %llu of them allocated past the first %d",
+			(unsigned long long)frames, (unsigned long long)steady_frames, CHURN_WARMUP_FRAMES);
+	for (int i = 0; i < n; i++) {
+		ChurnSite *site = &sites[i];
+		if (site->total_allocations == 0 && site->total_frees == 0 && site->total_created == 0
+			&& site->total_destroyed == 0)
+			continue;
+		SDL_Log("churn: %-16s %8llu allocations %10llu bytes %8llu frees %4llu textures created "
+				"%4llu destroyed, in %llu steady frames",
+				site->name, (unsigned long long)site->total_allocations,
+				(unsigned long long)site->total_bytes, (unsigned long long)site->total_frees,
+				(unsigned long long)site->total_created, (unsigned long long)site->total_destroyed,
+				(unsigned long long)site->steady_frames);
+		created += site->total_created;
+		destroyed += site->total_destroyed;
+	}
+	if (created != destroyed) {
+		SDL_Log("churn: %lld textures still alive", (long long)(created - destroyed));
+	}
+	muted = false;
+}
+
+#endif	// CHURN
@@ -0,0 +1,98 @@
+#ifndef CHURN_H
+#define CHURN_H
+
+/**
+ * Counts heap allocations and texture creations, per frame and per call site, to find what keeps
+ * allocating once the game runs. Frames past the warm up that allocate anything are reported, and
+ * a summary of every site is logged on exit.
+ *
+ * Allocations are seen through SDL_SetMemoryFunctions(), so the ones made by SDL, by the libraries
+ * built on it and through SDL_malloc() are counted, plain malloc() isn't. Call sites are the
+ * innermost CHURN_SITE open on the allocating thread, "other" outside of any.
+ *
+ * Only compiled in when CHURN is defined (make CHURN=1). Otherwise every macro expands to
+ * nothing.
+ */
+
+#ifdef CHURN
+
+#include <stdbool.h>
+
+/**
+ * @brief Call sites told apart. Allocations from sites past that count as "other".
+ */
+#define CHURN_MAX_SITES 32
+/**
+ * @brief Frames allowed to allocate at start up, before the game is in its steady state
+ */
+#define CHURN_WARMUP_FRAMES 120
+/**
+ * @brief Frames between two reports of frames that allocated. The ones in between are counted.
+ */
+#define CHURN_REPORT_INTERVAL 60
+
+/**
+ * Starts counting. Must be called before SDL allocates anything, first thing in SDL_AppInit().
+ *
+ * @return True if SDL took the counting allocator, false otherwise
+ */
+bool churn_init(void);
+
+/**
+ * Makes a site the one allocations of the calling thread are counted to.
+ *
+ * @param name Name of the site, must be a string literal
+ * @return The site that was current, to restore with churn_site_end()
+ */
+int churn_site_begin(const char *name);
+
+/**
+ * Makes the site that was current before churn_site_begin() current again.
+ *
+ * @param previous What churn_site_begin() returned
+ */
+void churn_site_end(int *previous);
+
+/**
+ * Counts a texture created or destroyed by the current site.
+ *
+ * @param created True if it was created, false if destroyed
+ */
+void churn_texture(bool created);
+
+/**
+ * Ends a frame, and reports it if it allocated past the warm up. Called once per frame, after
+ * presenting.
+ */
+void churn_frame(void);
+
+/**
+ * Logs how much every site allocated, and the textures still alive.
+ */
+void churn_dump(void);
+
+#define CHURN_CONCAT_(a, b) a##b
+#define CHURN_CONCAT(a, b) CHURN_CONCAT_(a, b)
+
+/**
+ * Counts allocations to a site until the end of the enclosing scope.
+ */
+#define CHURN_SITE(name)                                                                \
+	int CHURN_CONCAT(churn_site_, __LINE__) __attribute__((cleanup(churn_site_end))) \
+	  = churn_site_begin(name)
+
+#define CHURN_TEXTURE_CREATED() churn_texture(true)
+#define CHURN_TEXTURE_DESTROYED() churn_texture(false)
+
+#else
+
+#define churn_init() ((void)0)
+#define churn_frame() ((void)0)
+#define churn_dump() ((void)0)
+#define CHURN_SITE(name) ((void)0)
+#define CHURN_TEXTURE_CREATED() ((void)0)
+#define CHURN_TEXTURE_DESTROYED() ((void)0)
+
+#endif	// CHURN
+
+#endif	// !CHURN_H
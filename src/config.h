@@ -9,6 +9,22 @@
  * @brief Initial HEIGHT of the window
  */
 #define HEIGHT				600
+/**
+ * @brief Minimum WIDTH the window can be resized to
+ */
+#define MIN_WIDTH			200
+/**
+ * @brief Minimum HEIGHT the window can be resized to
+ */
+#define MIN_HEIGHT			150
+/**
+ * @brief WIDTH of the world. The window scrolls over it following the ship.
+ */
+#define WORLD_WIDTH			(4 * WIDTH)
+/**
+ * @brief HEIGHT of the world
+ */
+#define WORLD_HEIGHT		(4 * HEIGHT)
 /**
  * @brief Background color in "R, G, B" format
  */
@@ -21,6 +37,14 @@
  * Maximum number of frames per second
  */
 #define FPS					60
+/**
+ * @brief Ticks per frame of turbo mode when no speed is given, 0 for as many as fit in a frame
+ */
+#define TURBO_SPEED			0
+/**
+ * @brief Fraction of the frame turbo mode spends on ticks when running as many as fit
+ */
+#define TURBO_BUDGET		0.8
 
 /**
  * @brief Radius of the ship
@@ -59,11 +83,11 @@
 /**
  * @brief Asteroids to appear in level 1
  */
-#define MIN_ASTEROIDS		1
+#define MIN_ASTEROIDS		4
 /**
  * @brief Maximum number of asteroids that can appear in any level
  */
-#define MAX_ASTEROIDS		10
+#define MAX_ASTEROIDS		160
 /**
  * @brief Minimum radius of an asteroid
  */
@@ -85,4 +109,13 @@
  */
 #define ASTEROID_SPEED_MAX	3
 
+/**
+ * @brief Asteroids further than this from the view and from every bullet are updated less often
+ */
+#define ACTIVE_DISTANCE		300
+/**
+ * @brief Far asteroids are updated once every this many frames, with a step as many times larger
+ */
+#define FAR_UPDATE_INTERVAL 4
+
 #endif	// !CONFIG_H
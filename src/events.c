@@ -0,0 +1,76 @@
+#include "events.h"
+
+void events_init(EventRing *ring)
+{
+	SDL_SetAtomicU32(&ring->published, 0);
+	for (int i = 0; i < EVENT_READERS; i++) {
+		SDL_SetAtomicU32(&ring->consumed[i], 0);
+	}
+	SDL_SetAtomicInt(&ring->readers, 0);
+	ring->written = 0;
+	ring->free_until = 0;
+	ring->dropped = 0;
+}
+
+void events_emit(EventRing *ring, const GameEvent *event)
+{
+	int readers = SDL_GetAtomicInt(&ring->readers);
+
+	if (readers == 0) {
+		return;
+	}
+	/* Readers only ever free more, so the slowest one is only looked at once the ring seems full */
+	if (ring->written == ring->free_until) {
+		Uint32 behind = 0;
+		for (int i = 0; i < readers; i++) {
+			behind = SDL_max(behind, ring->written - SDL_GetAtomicU32(&ring->consumed[i]));
+		}
+		ring->free_until = ring->written + (EVENT_RING_SIZE - behind);
+		/* What they were done reading stays read before it is written over */
+		SDL_MemoryBarrierAcquire();
+		if (ring->written == ring->free_until) {
+			ring->dropped++;
+			return;
+		}
+	}
+	ring->events[ring->written % EVENT_RING_SIZE] = *event;
+	ring->written++;
+}
+
+void events_publish(EventRing *ring)
+{
+	/* Readers that see the count see the events before it */
+	SDL_MemoryBarrierRelease();
+	SDL_SetAtomicU32(&ring->published, ring->written);
+}
+
+int events_join(EventRing *ring)
+{
+	int reader = SDL_GetAtomicInt(&ring->readers);
+
+	if (reader == EVENT_READERS) {
+		return -1;
+	}
+	SDL_SetAtomicU32(&ring->consumed[reader], ring->written);
+	SDL_SetAtomicInt(&ring->readers, reader + 1);
+
+	return reader;
+}
+
+int events_read(EventRing *ring, int reader, GameEvent *events, int max)
+{
+	Uint32 consumed = SDL_GetAtomicU32(&ring->consumed[reader]);
+	Uint32 published = SDL_GetAtomicU32(&ring->published);
+	int n = (int)SDL_min(published - consumed, (Uint32)SDL_max(max, 0));
+
+	/* Nothing before the count it saw was written after it was published */
+	SDL_MemoryBarrierAcquire();
+	for (int i = 0; i < n; i++) {
+		events[i] = ring->events[(consumed + i) % EVENT_RING_SIZE];
+	}
+	/* Done reading them before the game may write over them */
+	SDL_MemoryBarrierRelease();
+	SDL_SetAtomicU32(&ring->consumed[reader], consumed + n);
+
+	return n;
+}
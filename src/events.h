@@ -0,0 +1,113 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <stdbool.h>
+
+#include <SDL3/SDL_atomic.h>
+#include <SDL3/SDL_stdinc.h>
+
+#include "store.h"
+
+/**
+ * What happens in the game, for whoever wants to know without looking at it: sounds, particles,
+ * scores, statistics.
+ *
+ * The simulation writes typed events into a ring allocated with the game, and publishes those of
+ * a tick once it is done. Readers each go through the ring at their own pace from any thread,
+ * without locks. The game never waits for them: when the slowest reader is a whole ring behind,
+ * new events are dropped and counted instead. Nothing is written while no reader has joined.
+ */
+
+/**
+ * @brief Events the ring holds, a power of two
+ */
+#define EVENT_RING_SIZE 4096
+/**
+ * @brief Readers that can join a ring at most
+ */
+#define EVENT_READERS 4
+
+/**
+ * Kinds of events.
+ */
+typedef enum {
+	EVENT_SHOT,		 /**< A bullet was fired, handle is the bullet */
+	EVENT_HIT,		 /**< A bullet hit an asteroid, handle is the asteroid, other the bullet */
+	EVENT_SPLIT,	 /**< A hit asteroid split in two, handle is the asteroid */
+	EVENT_DESTROYED, /**< A hit asteroid was too small to split, handle is the asteroid */
+	EVENT_CRASH,	 /**< The ship crashed into an asteroid, handle is the asteroid */
+	EVENT_LEVEL,	 /**< A level started, its wave just spawned */
+	EVENT_TYPES		 /**< Number of kinds of events */
+} GameEventType;
+
+/**
+ * Something that happened during a tick.
+ */
+typedef struct {
+	Uint64 tick;		/**< Tick it happened on */
+	GameEventType type; /**< What happened */
+	Handle handle;		/**< Entity it happened to, HANDLE_NONE if none */
+	Handle other;		/**< Other entity involved, HANDLE_NONE if none */
+	unsigned int level; /**< Level being played */
+	float x;			/**< X position of where it happened */
+	float y;			/**< Y position of where it happened */
+	float radius;		/**< Radius of the asteroid involved, 0 if none */
+} GameEvent;
+
+/**
+ * The ring. The game writes, publishes and counts drops, each reader only moves its own cursor.
+ */
+typedef struct {
+	GameEvent events[EVENT_RING_SIZE];	   /**< Events, at their number modulo the size */
+	SDL_AtomicU32 published;			   /**< Events readers may read, counted from the start */
+	SDL_AtomicU32 consumed[EVENT_READERS]; /**< Events each reader is done with */
+	SDL_AtomicInt readers;				   /**< Readers that joined */
+	Uint32 written;						   /**< Events written, published or not */
+	Uint32 free_until;					   /**< Events that can be written without waiting */
+	Uint64 dropped;						   /**< Events dropped because the ring was full */
+} EventRing;
+
+/**
+ * Empties a ring, with no readers.
+ *
+ * @param ring The ring to initialize
+ */
+void events_init(EventRing *ring);
+
+/**
+ * Writes an event, unpublished until events_publish(). Called by the simulation only.
+ *
+ * @param ring The ring
+ * @param event The event
+ */
+void events_emit(EventRing *ring, const GameEvent *event);
+
+/**
+ * Lets readers see every event written so far. Called by the simulation once per tick.
+ *
+ * @param ring The ring
+ */
+void events_publish(EventRing *ring);
+
+/**
+ * Joins a ring as a reader, from the thread running the game, between ticks. Readers only see
+ * events published after they joined, and never leave.
+ *
+ * @param ring The ring
+ * @return Number of the reader, -1 if EVENT_READERS already joined
+ */
+int events_join(EventRing *ring);
+
+/**
+ * Takes the oldest published events a reader hasn't read yet, from any thread. Each reader is
+ * read by one thread at a time.
+ *
+ * @param ring The ring
+ * @param reader Number of the reader
+ * @param events Where to copy them
+ * @param max Events that fit in events
+ * @return Number of events copied, 0 if there were none
+ */
+int events_read(EventRing *ring, int reader, GameEvent *events, int max);
+
+#endif	// !EVENTS_H
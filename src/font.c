@@ -0,0 +1,154 @@
+#include "font.h"
+
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_surface.h>
+
+#include "churn.h"
+
+#ifndef FONT_TTF
+#include "font_atlas.h"
+#endif
+
+/**
+ * @brief Glyphs sent to the renderer in one batch
+ */
+#define FONT_BATCH 32
+
+/**
+ * Metrics of the font being drawn
+ */
+static FontAtlas font;
+/**
+ * The atlas, white where there is a glyph and transparent elsewhere
+ */
+static SDL_Texture *atlas_texture;
+
+/**
+ * Expands the one bit atlas into a texture.
+ */
+static bool upload_atlas(SDL_Renderer *renderer, const FontAtlas *atlas)
+{
+	SDL_Surface *surface;
+	int pitch = (atlas->width + 7) / 8;
+
+	surface = SDL_CreateSurface(atlas->width, atlas->height, SDL_PIXELFORMAT_ARGB8888);
+	if (!surface) {
+		SDL_Log("Couldn't create font surface: %s", SDL_GetError());
+		return false;
+	}
+	for (int y = 0; y < atlas->height; y++) {
+		Uint32 *row = (Uint32 *)((Uint8 *)surface->pixels + y * surface->pitch);
+		for (int x = 0; x < atlas->width; x++) {
+			bool set = atlas->pixels[y * pitch + x / 8] & (0x80 >> (x % 8));
+			row[x] = set ? 0xFFFFFFFF : 0x00FFFFFF;
+		}
+	}
+
+	atlas_texture = SDL_CreateTextureFromSurface(renderer, surface);
+	SDL_DestroySurface(surface);
+	if (!atlas_texture) {
+		SDL_Log("Couldn't create font texture: %s", SDL_GetError());
+		return false;
+	}
+	CHURN_TEXTURE_CREATED();
+	return true;
+}
+
+bool font_init(SDL_Renderer *renderer)
+{
+	CHURN_SITE("font");
+#ifdef FONT_TTF
+	bool ok;
+
+	if (!font_rasterize(FONT_PATH, &font)) {
+		return false;
+	}
+	ok = upload_atlas(renderer, &font);
+	/* Only the metrics are needed from now on */
+	SDL_free((void *)font.pixels);
+	font.pixels = NULL;
+	return ok;
+#else
+	font = font_atlas;
+	return upload_atlas(renderer, &font);
+#endif
+}
+
+void font_quit(void)
+{
+	if (atlas_texture) {
+		SDL_DestroyTexture(atlas_texture);
+		CHURN_TEXTURE_DESTROYED();
+	}
+	atlas_texture = NULL;
+}
+
+/**
+ * Glyph of a character, the space if it isn't in the atlas.
+ */
+static const FontGlyph *font_glyph(char c)
+{
+	unsigned char index = (unsigned char)c - FONT_FIRST_GLYPH;
+	return &font.glyphs[index < FONT_GLYPHS ? index : 0];
+}
+
+void font_draw(SDL_Renderer *renderer, const char *text, float x, float y, float scale,
+			   SDL_FColor color)
+{
+	SDL_Vertex vertices[4 * FONT_BATCH];
+	int indices[6 * FONT_BATCH];
+	int n = 0;
+
+	if (!atlas_texture) {
+		return;
+	}
+
+	for (const char *c = text;; c++) {
+		/* Flush when the batch is full or the text is over */
+		if (n == FONT_BATCH || (*c == '\0' && n > 0)) {
+			SDL_RenderGeometry(renderer, atlas_texture, vertices, 4 * n, indices, 6 * n);
+			n = 0;
+		}
+		if (*c == '\0') {
+			break;
+		}
+
+		const FontGlyph *glyph = font_glyph(*c);
+		if (glyph->w > 0) {
+			float left = x + glyph->left * scale;
+			float top = y + glyph->top * scale;
+			float right = left + glyph->w * scale;
+			float bottom = top + glyph->h * scale;
+			float u0 = (float)glyph->x / font.width;
+			float v0 = (float)glyph->y / font.height;
+			float u1 = (float)(glyph->x + glyph->w) / font.width;
+			float v1 = (float)(glyph->y + glyph->h) / font.height;
+			SDL_Vertex *v = &vertices[4 * n];
+
+			v[0] = (SDL_Vertex){ { left, top }, color, { u0, v0 } };
+			v[1] = (SDL_Vertex){ { right, top }, color, { u1, v0 } };
+			v[2] = (SDL_Vertex){ { right, bottom }, color, { u1, v1 } };
+			v[3] = (SDL_Vertex){ { left, bottom }, color, { u0, v1 } };
+			SDL_memcpy(&indices[6 * n],
+					   (int[]){ 4 * n, 4 * n + 1, 4 * n + 2, 4 * n, 4 * n + 2, 4 * n + 3 },
+					   6 * sizeof(int));
+			n++;
+		}
+		x += glyph->advance * scale;
+	}
+}
+
+float font_width(const char *text, float scale)
+{
+	int width = 0;
+
+	for (const char *c = text; *c; c++) {
+		width += font_glyph(*c)->advance;
+	}
+	return width * scale;
+}
+
+float font_height(float scale)
+{
+	return font.line_height * scale;
+}
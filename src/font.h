@@ -0,0 +1,116 @@
+#ifndef FONT_H
+#define FONT_H
+
+#include <stdbool.h>
+
+#include <SDL3/SDL_render.h>
+#include <SDL3/SDL_stdinc.h>
+
+/**
+ * Text drawn from a glyph atlas, uploaded once as a single texture.
+ *
+ * The atlas is baked at build time by tools/bakefont.c into a generated header, so the game
+ * neither reads the font file nor needs SDL_ttf. Built with make TTF=1 the game rasterizes the
+ * font file at startup instead, the same way the baker does.
+ */
+
+/**
+ * @brief Font the atlas is rasterized from
+ */
+#define FONT_PATH "./font/AzeretMono.ttf"
+/**
+ * @brief Size the font is rasterized at. Smaller text is the atlas scaled down.
+ */
+#define FONT_SIZE 50
+/**
+ * @brief First character in the atlas
+ */
+#define FONT_FIRST_GLYPH ' '
+/**
+ * @brief Number of characters in the atlas, every printable ASCII one
+ */
+#define FONT_GLYPHS ('~' - ' ' + 1)
+/**
+ * @brief Maximum width of the atlas, glyphs are packed in rows up to it
+ */
+#define FONT_ATLAS_MAX_WIDTH 512
+
+/**
+ * Where a glyph is in the atlas and where it goes relative to the pen.
+ */
+typedef struct {
+	Uint16 x;	   /**< Left of the glyph in the atlas */
+	Uint16 y;	   /**< Top of the glyph in the atlas */
+	Uint8 w;	   /**< Width of the glyph, 0 if it has no pixels */
+	Uint8 h;	   /**< Height of the glyph */
+	Uint8 left;	   /**< Offset of the glyph from the pen, along X */
+	Uint8 top;	   /**< Offset of the glyph from the top of the line */
+	Uint8 advance; /**< How far the pen moves after the glyph */
+} FontGlyph;
+
+/**
+ * A rasterized font. Pixels are one bit each, rows start on a byte boundary, and the most
+ * significant bit is the leftmost pixel.
+ */
+typedef struct {
+	int width;						/**< Width of the atlas */
+	int height;						/**< Height of the atlas */
+	int line_height;				/**< Height of a line of text */
+	FontGlyph glyphs[FONT_GLYPHS];	/**< Every glyph, from FONT_FIRST_GLYPH */
+	const Uint8* pixels;			/**< The atlas, (width + 7) / 8 bytes per row */
+} FontAtlas;
+
+/**
+ * Rasterizes a font with SDL_ttf and packs its glyphs into an atlas. Only available when built
+ * with SDL_ttf.
+ *
+ * @param path Font file to rasterize
+ * @param atlas Atlas to fill. Its pixels have to be freed with SDL_free().
+ * @return True if the atlas was filled, false otherwise
+ */
+bool font_rasterize(const char *path, FontAtlas *atlas);
+
+/**
+ * Uploads the atlas as a texture. Must be called once before drawing any text.
+ *
+ * @param renderer Renderer the text will be drawn with
+ * @return True if the font is ready, false otherwise
+ */
+bool font_init(SDL_Renderer *renderer);
+
+/**
+ * Frees the atlas texture.
+ */
+void font_quit(void);
+
+/**
+ * Draws a line of text. Characters outside the atlas are drawn as spaces.
+ *
+ * @param renderer Renderer to draw with
+ * @param text Text to draw
+ * @param x Left of the text
+ * @param y Top of the text
+ * @param scale Size of the text relative to FONT_SIZE
+ * @param color Color of the text
+ */
+void font_draw(SDL_Renderer *renderer, const char *text, float x, float y, float scale,
+			   SDL_FColor color);
+
+/**
+ * Measures a line of text.
+ *
+ * @param text Text to measure
+ * @param scale Size of the text relative to FONT_SIZE
+ * @return Width of the text
+ */
+float font_width(const char *text, float scale);
+
+/**
+ * Height of a line of text.
+ *
+ * @param scale Size of the text relative to FONT_SIZE
+ * @return Height of the line
+ */
+float font_height(float scale);
+
+#endif	// !FONT_H
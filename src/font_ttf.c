@@ -0,0 +1,126 @@
+#include "font.h"
+
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_surface.h>
+#include <SDL3_ttf/SDL_ttf.h>
+
+/**
+ * @brief Empty pixels left around every glyph, so scaled text doesn't bleed into its neighbours
+ */
+#define GLYPH_PADDING 1
+
+/**
+ * Finds the smallest rectangle with every set pixel of a glyph surface.
+ *
+ * @return False if the glyph has no pixels
+ */
+static bool glyph_bounds(SDL_Surface *surface, SDL_Rect *bounds)
+{
+	int min_x = surface->w, min_y = surface->h, max_x = -1, max_y = -1;
+
+	for (int y = 0; y < surface->h; y++) {
+		const Uint8 *row = (const Uint8 *)surface->pixels + y * surface->pitch;
+		for (int x = 0; x < surface->w; x++) {
+			if (row[x]) {
+				min_x = SDL_min(min_x, x);
+				max_x = SDL_max(max_x, x);
+				min_y = SDL_min(min_y, y);
+				max_y = SDL_max(max_y, y);
+			}
+		}
+	}
+	if (max_x < 0) {
+		return false;
+	}
+
+	*bounds = (SDL_Rect){ min_x, min_y, max_x - min_x + 1, max_y - min_y + 1 };
+	return true;
+}
+
+bool font_rasterize(const char *path, FontAtlas *atlas)
+{
+	SDL_Surface *surfaces[FONT_GLYPHS] = { NULL };
+	SDL_Rect bounds[FONT_GLYPHS];
+	TTF_Font *font;
+	Uint8 *pixels;
+	int pen_x = 0, pen_y = 0, row_height = 0, pitch;
+	bool ok = false;
+
+	SDL_zerop(atlas);
+	if (!TTF_Init()) {
+		SDL_Log("Couldn't initialise SDL_ttf: %s", SDL_GetError());
+		return false;
+	}
+	font = TTF_OpenFont(path, FONT_SIZE);
+	if (!font) {
+		SDL_Log("Couldn't load font: %s", SDL_GetError());
+		TTF_Quit();
+		return false;
+	}
+	atlas->line_height = TTF_GetFontHeight(font);
+
+	/* Pack the glyphs in rows, left to right */
+	for (int i = 0; i < FONT_GLYPHS; i++) {
+		FontGlyph *glyph = &atlas->glyphs[i];
+		int advance;
+
+		if (!TTF_GetGlyphMetrics(font, FONT_FIRST_GLYPH + i, NULL, NULL, NULL, NULL, &advance)) {
+			SDL_Log("Couldn't get metrics of '%c': %s", FONT_FIRST_GLYPH + i, SDL_GetError());
+			goto out;
+		}
+		glyph->advance = advance;
+
+		/* Solid rendering, as the game always used: one palette index per pixel, 0 is empty */
+		surfaces[i]
+		  = TTF_RenderGlyph_Solid(font, FONT_FIRST_GLYPH + i, (SDL_Color){ 255, 255, 255, 255 });
+		if (!surfaces[i] || !glyph_bounds(surfaces[i], &bounds[i])) {
+			continue;
+		}
+
+		if (pen_x + bounds[i].w + GLYPH_PADDING > FONT_ATLAS_MAX_WIDTH) {
+			pen_x = 0;
+			pen_y += row_height;
+			row_height = 0;
+		}
+		glyph->x = pen_x + GLYPH_PADDING;
+		glyph->y = pen_y + GLYPH_PADDING;
+		glyph->w = bounds[i].w;
+		glyph->h = bounds[i].h;
+		glyph->left = bounds[i].x;
+		glyph->top = bounds[i].y;
+		pen_x += bounds[i].w + GLYPH_PADDING;
+		row_height = SDL_max(row_height, bounds[i].h + GLYPH_PADDING);
+		atlas->width = SDL_max(atlas->width, pen_x + GLYPH_PADDING);
+	}
+	atlas->height = pen_y + row_height + GLYPH_PADDING;
+
+	pitch = (atlas->width + 7) / 8;
+	pixels = SDL_calloc(atlas->height, pitch);
+	if (!pixels) {
+		SDL_Log("Couldn't allocate memory: %s", SDL_GetError());
+		goto out;
+	}
+	for (int i = 0; i < FONT_GLYPHS; i++) {
+		FontGlyph *glyph = &atlas->glyphs[i];
+		for (int y = 0; y < glyph->h; y++) {
+			const Uint8 *row = (const Uint8 *)surfaces[i]->pixels
+							   + (bounds[i].y + y) * surfaces[i]->pitch + bounds[i].x;
+			for (int x = 0; x < glyph->w; x++) {
+				if (row[x]) {
+					int px = glyph->x + x;
+					pixels[(glyph->y + y) * pitch + px / 8] |= 0x80 >> (px % 8);
+				}
+			}
+		}
+	}
+	atlas->pixels = pixels;
+	ok = true;
+
+out:
+	for (int i = 0; i < FONT_GLYPHS; i++) {
+		SDL_DestroySurface(surfaces[i]);
+	}
+	TTF_CloseFont(font);
+	TTF_Quit();
+	return ok;
+}
@@ -7,9 +7,41 @@
 #include <SDL3/SDL_stdinc.h>
 
 #include "config.h"
+#include "jobs.h"
+#include "profile.h"
 
 #define GRACE_SPACING 5
 
+/**
+ * Applies the queued inputs, in the order they happened, and empties the queue.
+ *
+ * @param game The game to update
+ */
+void process_inputs(Game *game);
+
+/**
+ * Shoots a bullet from the ship. It is added when the bullets are committed.
+ *
+ * @param game The game to update
+ * @param advance Frames the bullet has already travelled by the time it is added
+ * @return True if the bullet was shot, false if there are too many
+ */
+bool shoot(Game *game, Real advance);
+
+/**
+ * Writes an event of the tick being simulated into the ring of the game.
+ *
+ * @param game The game
+ * @param type What happened
+ * @param handle Entity it happened to, HANDLE_NONE if none
+ * @param other Other entity involved, HANDLE_NONE if none
+ * @param x X position of where it happened
+ * @param y Y position of where it happened
+ * @param radius Radius of the asteroid involved, 0 if none
+ */
+void emit_event(Game *game, GameEventType type, Handle handle, Handle other, Real x, Real y,
+				Real radius);
+
 /**
  * Updates the position of the player in the game.
  *
@@ -18,34 +50,243 @@
 void update_player_position(Game *game);
 
 /**
- * Updates the position of the bullets in the game.
+ * Updates the position of some of the bullets in the game. The ones that leave the world are
+ * destroyed afterwards, by destroy_lost_bullets().
  *
  * Bullets HAVE TO GO before asteroids.
  *
  * @param game The game to update
+ * @param begin First bullet to update
+ * @param end One past the last bullet to update
  */
-void update_bullets_position(Game *game);
+void update_bullets_position(Game *game, int begin, int end);
 /**
- * Updates the position of the asteroids in the game.
- * 
+ * Destroys the bullets that left the world.
+ *
  * @param game The game to update
  */
-void update_asteroids_position(Game *game);
+void destroy_lost_bullets(Game *game);
 /**
- * Handles player-asteroid, bullet-asteroid, and asteroid-asteroid collisions. In that order
- * 
+ * Marks as active the parts of the world close to the view or to a bullet.
+ *
+ * @param game The game to update
+ */
+void mark_active(Game *game);
+/**
+ * Updates the position of some of the asteroids in the game.
+ *
+ * @param game The game to update
+ * @param begin First asteroid to update
+ * @param end One past the last asteroid to update
+ */
+void update_asteroids_position(Game *game, int begin, int end);
+/**
+ * Handles player-asteroid and bullet-asteroid collisions. In that order
+ *
+ * @param game The game to update
+ * @return True if an asteroid hit the player, false otherwise
+ */
+bool handle_hits(Game *game);
+/**
+ * Handles the asteroid-asteroid collisions found from the asteroids of a strip of the grid.
+ *
  * @param game The game to update
- */ 
-void handle_collisions(Game *game);
+ * @param strip Index of the strip
+ */
+void collide_strip(Game *game, int strip);
+
+/**
+ * Moves the ship. Like every stage of a frame run by the job system, data is the game, and begin
+ * and end the range of items to handle.
+ */
+void ship_job(void *data, int begin, int end);
+/**
+ * Moves a range of bullets.
+ */
+void bullets_job(void *data, int begin, int end);
+/**
+ * Destroys the bullets that left the world, then marks what is active.
+ */
+void activity_job(void *data, int begin, int end);
+/**
+ * Moves a range of asteroids.
+ */
+void asteroids_job(void *data, int begin, int end);
+/**
+ * Handles the hits, and decides whether asteroid-asteroid collisions are skipped this frame.
+ */
+void hits_job(void *data, int begin, int end);
+/**
+ * Locates a range of asteroids in the grid.
+ */
+void locate_job(void *data, int begin, int end);
+/**
+ * Works out the order of the asteroids in the strips.
+ */
+void sort_job(void *data, int begin, int end);
+/**
+ * Puts a range of asteroids in their strips.
+ */
+void scatter_job(void *data, int begin, int end);
+/**
+ * Fills the cells of a range of strips.
+ */
+void fill_job(void *data, int begin, int end);
+/**
+ * Handles the collisions of a range of the even strips, the first one being strip 0.
+ */
+void even_strips_job(void *data, int begin, int end);
+/**
+ * Same, for the odd strips, the first one being strip 1.
+ */
+void odd_strips_job(void *data, int begin, int end);
+/**
+ * Empties the cells of a range of strips.
+ */
+void clear_job(void *data, int begin, int end);
 
 /**
- * Creates the asteroids corresponding to the current level
+ * Creates the asteroids corresponding to the current level. They never overlap each other, nor
+ * the clearance around the ship.
  * 
  * @param game The game to update
  */
 void create_asteroids(Game *game);
 
+/**
+ * Picks a random place for a new asteroid in the band along one of the edges of the world.
+ *
+ * @param game The game
+ * @param asteroid The asteroid, with its radius set
+ * @param band Depth of the band
+ */
+void spawn_position(Game *game, Asteroid *asteroid, int band);
+
+/**
+ * Checks whether a new asteroid is clear of the ship and of the ones spawned before it.
+ *
+ * @param game The game, its grid holding the asteroids spawned so far
+ * @param wave The asteroids spawned so far
+ * @param asteroid The new asteroid
+ * @return True if it touches none of them, false otherwise
+ */
+bool spawn_fits(Game *game, const Asteroid *wave, const Asteroid *asteroid);
+
+/**
+ * Moves an asteroid back inside the world if it is touching or past an edge. Its velocity is left
+ * untouched.
+ *
+ * @param game The game the asteroid belongs to
+ * @param asteroid The asteroid to move
+ */
+void clamp_asteroid_position(Game *game, Asteroid *asteroid);
+
+/**
+ * Destroys an asteroid hit by a bullet. Big enough ones split in two halves, if there is room.
+ *
+ * @param game The game the asteroid belongs to
+ * @param index Index of the asteroid
+ */
+void break_asteroid(Game *game, int index);
+
+/**
+ * Resolves the collision between two asteroids, if they are colliding.
+ *
+ * @param game The game the asteroids belong to
+ * @param a1 One asteroid
+ * @param a2 The other asteroid
+ * @return True if they collided and were changed, false otherwise
+ */
+bool collide_asteroids(Game *game, Asteroid *a1, Asteroid *a2);
+
+/**
+ * Computes where the view is in the world, like game_view() but exactly.
+ *
+ * @param game The game
+ * @param x Where to put the left of the view
+ * @param y Where to put the top of the view
+ */
+void view_origin(Game *game, Real *x, Real *y);
+
+/**
+ * Finds the grid cell a point falls in. Points outside the world go to the closest cell.
+ *
+ * @param grid The grid
+ * @param x X position of the point
+ * @param y Y position of the point
+ * @return Index of the cell
+ */
+int grid_cell(Grid *grid, Real x, Real y);
+
+/**
+ * Checks whether a point is in an active part of the world.
+ *
+ * @param grid The grid
+ * @param x X position of the point
+ * @param y Y position of the point
+ * @return True if the activity cell the point falls in was marked
+ */
+bool grid_is_active(Grid *grid, Real x, Real y);
+
+/**
+ * Marks as active every activity cell a rectangle touches.
+ *
+ * @param grid The grid
+ * @param x Left of the rectangle
+ * @param y Top of the rectangle
+ * @param w Width of the rectangle
+ * @param h Height of the rectangle
+ */
+void grid_mark_active(Grid *grid, Real x, Real y, Real w, Real h);
+
+/**
+ * Finds the cell of some of the asteroids, and counts the ones alive in each strip. The asteroids
+ * must be a whole job of ASTEROID_JOB_SIZE.
+ *
+ * @param game The game to update
+ * @param begin First asteroid
+ * @param end One past the last asteroid
+ */
+void grid_locate(Game *game, int begin, int end);
+
+/**
+ * Works out where the asteroids of each strip, and of each job within it, go in strip_items.
+ *
+ * @param game The game to update
+ */
+void grid_sort(Game *game);
+
+/**
+ * Puts some of the asteroids alive in the list of their strip, once grid_sort() ran.
+ *
+ * @param game The game to update
+ * @param begin First asteroid, the same job as in grid_locate()
+ * @param end One past the last asteroid
+ */
+void grid_scatter(Game *game, int begin, int end);
+
+/**
+ * Puts every asteroid of a strip in its cell.
+ *
+ * @param game The game to update
+ * @param strip Index of the strip
+ */
+void grid_fill(Game *game, int strip);
+
+/**
+ * Empties the cells grid_fill() filled in a strip. Only touches those cells.
+ *
+ * @param game The game to update
+ * @param strip Index of the strip
+ */
+void grid_clear(Game *game, int strip);
+
 bool game_init(Game **game)
+{
+	return game_init_field(game, WORLD_WIDTH, WORLD_HEIGHT, ASTEROID_CAPACITY);
+}
+
+bool game_init_field(Game **game, int world_width, int world_height, int asteroid_capacity)
 {
 	Player *player;
 
@@ -64,22 +305,59 @@ bool game_init(Game **game)
 
 	(*game)->width = WIDTH;
 	(*game)->height = HEIGHT;
+	(*game)->world_width = world_width;
+	(*game)->world_height = world_height;
 	(*game)->state = MENU;
 	(*game)->player = NULL;
-	(*game)->asteroids = malloc(MAX_ASTEROIDS * sizeof(Asteroid));
-	if (!(*game)->asteroids) {
-		SDL_Log("Couldn't allocate memory: %s", SDL_GetError());
+	if (!store_init(&(*game)->asteroids, sizeof(AsteroidData), asteroid_capacity)) {
 		return false;
 	}
-	(*game)->bullets = malloc(MAX_BULLETS * sizeof(Bullet));
-	if (!(*game)->bullets) {
-		SDL_Log("Couldn't allocate memory: %s", SDL_GetError());
+#ifdef COMPACT
+	/* The finest steps the whole world fits in 16 bits with */
+	(*game)->position_shift = 0;
+	while ((REAL(SDL_max(world_width, world_height)) >> (*game)->position_shift) > SDL_MAX_UINT16) {
+		(*game)->position_shift++;
+	}
+#endif
+	if (!store_init(&(*game)->bullets, sizeof(Bullet), MAX_BULLETS)) {
+		return false;
+	}
+	if (!narrowphase_init(&(*game)->narrowphase, asteroid_capacity)) {
 		return false;
 	}
-	(*game)->n_asteroids = 0;
-	(*game)->n_bullets = 0;
+	events_init(&(*game)->events);
+	SDL_SetAtomicInt(&(*game)->pair_tests, 0);
 	(*game)->level = 0;
 
+	/* Spatial grid */
+	Grid *grid = &(*game)->grid;
+	grid->columns = world_width / GRID_CELL + 1;
+	grid->rows = world_height / GRID_CELL + 1;
+	grid->active_columns = world_width / ACTIVE_DISTANCE + 1;
+	grid->active_rows = world_height / ACTIVE_DISTANCE + 1;
+	grid->strips = (grid->columns + STRIP_COLUMNS - 1) / STRIP_COLUMNS;
+	grid->active = malloc(grid->active_columns * grid->active_rows * sizeof(Uint8));
+	grid->head = malloc(grid->columns * grid->rows * sizeof(int));
+	grid->next = malloc(asteroid_capacity * sizeof(int));
+	grid->cells = malloc(asteroid_capacity * sizeof(int));
+	grid->strip_start = malloc((grid->strips + 1) * sizeof(int));
+	grid->strip_counts = malloc((asteroid_capacity + ASTEROID_JOB_SIZE - 1) / ASTEROID_JOB_SIZE
+								* grid->strips * sizeof(int));
+	grid->strip_items = malloc(asteroid_capacity * sizeof(int));
+	if (!grid->active || !grid->head || !grid->next || !grid->cells || !grid->strip_start
+		|| !grid->strip_counts || !grid->strip_items) {
+		SDL_Log("Couldn't allocate memory: %s", SDL_GetError());
+		return false;
+	}
+	for (int cell = 0; cell < grid->columns * grid->rows; cell++) {
+		grid->head[cell] = -1;
+	}
+	(*game)->tick = 0;
+	(*game)->n_inputs = 0;
+	(*game)->time = 0;
+	(*game)->cheap_collisions = false;
+	grid->built = false;
+
 	/* Setup for the player/ship */
 	player = malloc(sizeof(Player));
 	if (!player) {
@@ -87,12 +365,14 @@ bool game_init(Game **game)
 		return false;
 	}
 
-	player->x = (float)WIDTH / 2;
-	player->y = (float)HEIGHT / 2;
+	player->x = REAL(world_width) / 2;
+	player->y = REAL(world_height) / 2;
 	player->direction = 0;
 	player->direction_state = STILL;
 	player->velocity = 0;
 	player->acceleration_state = CONSTANT;
+	player->tap_direction = STILL;
+	player->tap_acceleration = CONSTANT;
 
 	memcpy(player->indices, (int[]){ BOW, STARBOARD, AFT, BOW, PORT, AFT },
 		   sizeof(player->indices));
@@ -106,306 +386,909 @@ bool game_init(Game **game)
 
 bool game_update_frame(Game *game)
 {
+	PROFILE_FUNCTION();
 	Player *player = game->player;
+	Grid *grid = &game->grid;
+	JobGraph graph;
 
 	if (!game || !player) {
 		return false;
 	}
 
-	if (game->n_asteroids == 0) {
+	if (game->asteroids.count == 0) {
 		game->level++;
 		create_asteroids(game);
+		emit_event(game, EVENT_LEVEL, HANDLE_NONE, HANDLE_NONE, 0, 0, 0);
+	}
+
+	process_inputs(game);
+	SDL_SetAtomicInt(&game->pair_tests, 0);
+
+	/*
+	 * The ship and the bullets move at the same time. What is active depends on both, and the
+	 * asteroids need it to move. Hits need everything in place, and decide whether asteroids
+	 * collide with each other. If they do, they are sorted into strips, which fill their cells,
+	 * resolve collisions, even strips first, and empty their cells.
+	 */
+	int count = game->asteroids.count;
+	int strips_per_job = SDL_max(1, COLLISION_JOB_SIZE * grid->strips / SDL_max(1, count));
+	jobs_graph_init(&graph);
+	int ship = jobs_stage(&graph, "ship", ship_job, game, 1, 1, 0);
+	int bullets = jobs_stage(&graph, "bullets", bullets_job, game, game->bullets.count,
+							 BULLET_JOB_SIZE, 0);
+	int activity = jobs_stage(&graph, "activity", activity_job, game, 1, 1,
+							  JOB_AFTER(ship) | JOB_AFTER(bullets));
+	int asteroids = jobs_stage(&graph, "asteroids", asteroids_job, game, count, ASTEROID_JOB_SIZE,
+							   JOB_AFTER(activity));
+	int hits = jobs_stage(&graph, "hits", hits_job, game, 1, 1, JOB_AFTER(asteroids));
+	int locate = jobs_stage(&graph, "locate", locate_job, game, count, ASTEROID_JOB_SIZE,
+							JOB_AFTER(hits));
+	int sort = jobs_stage(&graph, "sort", sort_job, game, 1, 1, JOB_AFTER(locate));
+	int scatter = jobs_stage(&graph, "scatter", scatter_job, game, count, ASTEROID_JOB_SIZE,
+							 JOB_AFTER(sort));
+	int fill = jobs_stage(&graph, "fill", fill_job, game, grid->strips, strips_per_job,
+						  JOB_AFTER(scatter));
+	int even = jobs_stage(&graph, "even strips", even_strips_job, game, (grid->strips + 1) / 2,
+						  strips_per_job, JOB_AFTER(fill));
+	int odd = jobs_stage(&graph, "odd strips", odd_strips_job, game, grid->strips / 2,
+						 strips_per_job, JOB_AFTER(even));
+	jobs_stage(&graph, "clear", clear_job, game, grid->strips, strips_per_job, JOB_AFTER(odd));
+	jobs_run(&graph);
+
+	/* Nothing refers to dense indices past this point, so the stores can be compacted */
+	store_commit(&game->asteroids);
+	store_commit(&game->bullets);
+	events_publish(&game->events);
+	game->tick++;
+
+	return true;
+}
+
+bool game_input(Game *game, InputAction action, bool down, Uint64 timestamp)
+{
+	if (game->n_inputs >= INPUT_QUEUE_SIZE) {
+		return false;
 	}
 
-	update_player_position(game);
-	update_bullets_position(game);
-	update_asteroids_position(game);
-	handle_collisions(game);
+	game->inputs[game->n_inputs++]
+	  = (InputEvent){ .timestamp = timestamp, .action = action, .down = down };
 
 	return true;
 }
 
 bool game_shoot(Game *game)
+{
+	if (!shoot(game, 0)) {
+		return false;
+	}
+	store_commit(&game->bullets);
+
+	return true;
+}
+
+bool shoot(Game *game, Real advance)
 {
 	Player *player = game->player;
 
-	if (game->n_bullets >= MAX_BULLETS || game->bullets == NULL) {
+	Real dx = REAL_MUL(real_sin(player->direction), REAL(BULLET_VELOCITY));
+	Real dy = -REAL_MUL(real_cos(player->direction), REAL(BULLET_VELOCITY));
+	Bullet bullet = { .dx = dx,
+					  .dy = dy,
+					  .x = player->x + REAL_MUL(dx, advance),
+					  .y = player->y + REAL_MUL(dy, advance) };
+
+	/* Shot from the edge, it has already left the world */
+	if (bullet.x >= REAL(game->world_width) || bullet.x <= 0
+		|| bullet.y >= REAL(game->world_height) || bullet.y <= 0) {
+		return true;
+	}
+	Handle handle = store_create(&game->bullets, &bullet);
+	if (handle == HANDLE_NONE) {
 		return false;
 	}
-
-	game->bullets[game->n_bullets++]
-	  = (Bullet){ .dx = SDL_sin(player->direction * SDL_PI_D / 180.0) * BULLET_VELOCITY,
-				  .dy = -SDL_cos(player->direction * SDL_PI_D / 180.0) * BULLET_VELOCITY,
-				  .x = player->x,
-				  .y = player->y };
+	emit_event(game, EVENT_SHOT, handle, HANDLE_NONE, bullet.x, bullet.y, 0);
 
 	return true;
 }
 
-void game_resize(Game *game)
+void emit_event(Game *game, GameEventType type, Handle handle, Handle other, Real x, Real y,
+				Real radius)
+{
+	events_emit(&game->events, &(GameEvent){ .tick = game->tick,
+											  .type = type,
+											  .handle = handle,
+											  .other = other,
+											  .level = game->level,
+											  .x = REAL_FLOAT(x),
+											  .y = REAL_FLOAT(y),
+											  .radius = REAL_FLOAT(radius) });
+}
+
+void process_inputs(Game *game)
 {
-	// We have to make sure this resize doesn't cause problems
+	PROFILE_FUNCTION();
 	Player *player = game->player;
-	if (player->x >= game->width - SHIP_RADIUS) {
-		player->x = game->width - SHIP_RADIUS - GRACE_SPACING;
+	Uint64 frame_ns = SDL_NS_PER_SECOND / FPS;
+
+	for (int i = 0; i < game->n_inputs; i++) {
+		InputEvent *input = &game->inputs[i];
+		switch (input->action) {
+		case INPUT_LEFT:
+		case INPUT_RIGHT:
+			if (input->down) {
+				player->direction_state
+				  = (input->action == INPUT_LEFT) ? COUNTER_CLOCKWISE : CLOCKWISE;
+				player->tap_direction = player->direction_state;
+			} else {
+				player->direction_state = STILL;
+			}
+			break;
+		case INPUT_THRUST:
+		case INPUT_BRAKE:
+			if (input->down) {
+				player->acceleration_state
+				  = (input->action == INPUT_THRUST) ? ACCELERATING : DECELERATING;
+				player->tap_acceleration = player->acceleration_state;
+			} else {
+				player->acceleration_state = CONSTANT;
+			}
+			break;
+		case INPUT_FIRE:
+			if (!input->down) {
+				break;
+			}
+			/*
+			 * Earlier shots have travelled further by the time the frame starts. Every shot
+			 * travels this frame too, even though it's only added at its end.
+			 */
+			Real advance = 0;
+			if (game->time > input->timestamp) {
+				advance = REAL_RATIO(game->time - input->timestamp, frame_ns);
+				if (advance > REAL(1)) {
+					advance = REAL(1);
+				}
+			}
+			shoot(game, REAL(1) + advance);
+			break;
+		}
 	}
-	if (player->x <= SHIP_RADIUS) {
-		player->x = SHIP_RADIUS + GRACE_SPACING;
+	game->n_inputs = 0;
+}
+
+void game_resize(Game *game)
+{
+	// The world doesn't change size, only the view into it does
+	if (game->width < MIN_WIDTH) {
+		game->width = MIN_WIDTH;
 	}
-	if (player->y >= game->height - SHIP_RADIUS) {
-		player->y = game->height - SHIP_RADIUS - GRACE_SPACING;
+	if (game->height < MIN_HEIGHT) {
+		game->height = MIN_HEIGHT;
 	}
-	if (player->y <= SHIP_RADIUS) {
-		player->y = SHIP_RADIUS + GRACE_SPACING;
+}
+
+void game_view(Game *game, SDL_FRect *view)
+{
+	Real x, y;
+
+	view_origin(game, &x, &y);
+	view->x = REAL_FLOAT(x);
+	view->y = REAL_FLOAT(y);
+	view->w = game->width;
+	view->h = game->height;
+}
+
+void view_origin(Game *game, Real *x, Real *y)
+{
+	Real w = REAL(game->width);
+	Real h = REAL(game->height);
+
+	/* Centered on the ship, but never showing past the edges unless the world is smaller */
+	*x = game->player->x - w / 2;
+	if (*x > REAL(game->world_width) - w) {
+		*x = REAL(game->world_width) - w;
 	}
-	for (int i = 0; i < game->n_asteroids; i++) {
-		Asteroid *asteroid = &game->asteroids[i];
-		if (asteroid->x >= game->width - asteroid->radius) {
-			asteroid->x = game->width - asteroid->radius - GRACE_SPACING;
-		}
-		if (asteroid->x <= asteroid->radius) {
-			asteroid->x = asteroid->radius + GRACE_SPACING;
-		}
-		if (asteroid->y >= game->height - asteroid->radius) {
-			asteroid->y = game->height - asteroid->radius - GRACE_SPACING;
-		}
-		if (asteroid->y <= asteroid->radius) {
-			asteroid->y = asteroid->radius + GRACE_SPACING;
-		}
+	if (*x < 0) {
+		*x = (game->world_width < game->width) ? REAL(game->world_width - game->width) / 2 : 0;
+	}
+	*y = game->player->y - h / 2;
+	if (*y > REAL(game->world_height) - h) {
+		*y = REAL(game->world_height) - h;
+	}
+	if (*y < 0) {
+		*y = (game->world_height < game->height) ? REAL(game->world_height - game->height) / 2
+												 : 0;
 	}
 }
 
 void game_reset(Game *game)
 {
-	game->n_asteroids = 0;
-	game->n_bullets = 0;
+	store_clear(&game->asteroids);
+	store_clear(&game->bullets);
 	game->level = 0;
-	game->player->x = (float)game->width / 2;
-	game->player->y = (float)game->height / 2;
+	game->player->x = REAL(game->world_width) / 2;
+	game->player->y = REAL(game->world_height) / 2;
 	game->player->direction = 0;
 	game->player->direction_state = STILL;
 	game->player->velocity = 0;
 	game->player->acceleration_state = CONSTANT;
+	game->player->tap_direction = STILL;
+	game->player->tap_acceleration = CONSTANT;
+	game->n_inputs = 0;
 }
 
 void game_free(Game *game)
 {
 	if (!game)
 		return;
-	if (game->asteroids)
-		free(game->asteroids);
-	if (game->bullets)
-		free(game->bullets);
+	store_free(&game->asteroids);
+	store_free(&game->bullets);
+	narrowphase_free(&game->narrowphase);
 	if (game->player)
 		free(game->player);
+	free(game->grid.active);
+	free(game->grid.head);
+	free(game->grid.next);
+	free(game->grid.cells);
+	free(game->grid.strip_start);
+	free(game->grid.strip_counts);
+	free(game->grid.strip_items);
 	free(game);
 }
 
 void update_player_position(Game *game)
 {
+	PROFILE_FUNCTION();
 	Player *player = game->player;
-	if (player->direction_state == CLOCKWISE) {
+	/* A key pressed and released within a frame still acts on that frame */
+	DirectionState direction_state
+	  = (player->direction_state != STILL) ? player->direction_state : player->tap_direction;
+	AccelerationState acceleration_state = (player->acceleration_state != CONSTANT)
+											 ? player->acceleration_state
+											 : player->tap_acceleration;
+	player->tap_direction = STILL;
+	player->tap_acceleration = CONSTANT;
+
+	if (direction_state == CLOCKWISE) {
 		player->direction = (player->direction + ROTATION_SPEED) % 360;
-	} else if (player->direction_state == COUNTER_CLOCKWISE) {
+	} else if (direction_state == COUNTER_CLOCKWISE) {
 		player->direction = (player->direction + 360 - ROTATION_SPEED) % 360;
 	}
-	if (player->acceleration_state == ACCELERATING && player->velocity < MAX_SPEED) {
-		player->velocity += SPEED_ACCEL;
-		if (player->velocity > MAX_SPEED) {
-			player->velocity = MAX_SPEED;
+	if (acceleration_state == ACCELERATING && player->velocity < REAL(MAX_SPEED)) {
+		player->velocity += REAL(SPEED_ACCEL);
+		if (player->velocity > REAL(MAX_SPEED)) {
+			player->velocity = REAL(MAX_SPEED);
 		}
-	} else if (player->acceleration_state == DECELERATING && player->velocity > MIN_SPEED) {
-		player->velocity -= SPEED_ACCEL;
+	} else if (acceleration_state == DECELERATING && player->velocity > REAL(MIN_SPEED)) {
+		player->velocity -= REAL(SPEED_ACCEL);
 		/* Due to floating point, when MIN_SPEED is 0, we can get a bit of backwards movement */
-		if (player->velocity < MIN_SPEED) {
-			player->velocity = MIN_SPEED;
+		if (player->velocity < REAL(MIN_SPEED)) {
+			player->velocity = REAL(MIN_SPEED);
 		}
 	}
-	float x_change = SDL_sin(player->direction * SDL_PI_D / 180.0) * player->velocity;
-	float y_change = -SDL_cos(player->direction * SDL_PI_D / 180.0) * player->velocity;
-	if (player->x + x_change >= 0 && player->x + x_change <= game->width) {
+	Real x_change = REAL_MUL(real_sin(player->direction), player->velocity);
+	Real y_change = -REAL_MUL(real_cos(player->direction), player->velocity);
+	if (player->x + x_change >= 0 && player->x + x_change <= REAL(game->world_width)) {
 		player->x += x_change;
 	}
-	if (player->y + y_change >= 0 && player->y + y_change <= game->height) {
+	if (player->y + y_change >= 0 && player->y + y_change <= REAL(game->world_height)) {
 		player->y += y_change;
 	}
 }
 
-void update_bullets_position(Game *game)
+void update_bullets_position(Game *game, int begin, int end)
 {
-	for (int i = 0; i < game->n_bullets; i++) {
-		Bullet *bullet = &game->bullets[i];
+	Bullet *bullets = game->bullets.items;
+	for (int i = begin; i < end; i++) {
+		Bullet *bullet = &bullets[i];
 		bullet->x += bullet->dx;
 		bullet->y += bullet->dy;
-		if (bullet->x >= game->width || bullet->x <= 0 || bullet->y >= game->height
-			|| bullet->y <= 0) {
-			game->bullets[i] = game->bullets[--game->n_bullets];
-			i--;
+	}
+}
+
+void destroy_lost_bullets(Game *game)
+{
+	Bullet *bullets = game->bullets.items;
+	/* Not while moving them, destroying isn't safe from several threads */
+	for (int i = 0; i < game->bullets.count; i++) {
+		Bullet *bullet = &bullets[i];
+		if (bullet->x >= REAL(game->world_width) || bullet->x <= 0
+			|| bullet->y >= REAL(game->world_height) || bullet->y <= 0) {
+			store_destroy(&game->bullets, i);
+		}
+	}
+}
+
+void mark_active(Game *game)
+{
+	PROFILE_FUNCTION();
+	Grid *grid = &game->grid;
+	Bullet *bullets = game->bullets.items;
+	Real x, y;
+
+	/* Whatever is close to what the player sees, or to a bullet, is active */
+	SDL_memset(grid->active, 0, grid->active_columns * grid->active_rows);
+	view_origin(game, &x, &y);
+	grid_mark_active(grid, x - REAL(ACTIVE_DISTANCE), y - REAL(ACTIVE_DISTANCE),
+					 REAL(game->width + 2 * ACTIVE_DISTANCE),
+					 REAL(game->height + 2 * ACTIVE_DISTANCE));
+	for (int i = 0; i < game->bullets.count; i++) {
+		if (store_alive(&game->bullets, i)) {
+			grid_mark_active(grid, bullets[i].x - REAL(ACTIVE_DISTANCE),
+							 bullets[i].y - REAL(ACTIVE_DISTANCE), REAL(2 * ACTIVE_DISTANCE),
+							 REAL(2 * ACTIVE_DISTANCE));
 		}
 	}
 }
 
-void update_asteroids_position(Game *game)
+void update_asteroids_position(Game *game, int begin, int end)
 {
-	for (int i = 0; i < game->n_asteroids; i++) {
-		Asteroid *asteroid = &game->asteroids[i];
-		asteroid->x += asteroid->dx;
-		asteroid->y += asteroid->dy;
-		if (asteroid->x >= game->width - asteroid->radius) {
+	Grid *grid = &game->grid;
+
+	for (int i = begin; i < end; i++) {
+		Asteroid unpacked = asteroid_get(game, i);
+		Asteroid *asteroid = &unpacked;
+		bool active = grid_is_active(grid, asteroid->x, asteroid->y);
+		Uint8 steps = 1;
+
+		/*
+		 * Far asteroids sleep between updates. When they wake up, because it's their turn or
+		 * because something came close, they catch up on the frames they missed.
+		 */
+		if (asteroid->far) {
+			steps = (Uint8)game->tick - asteroid->updated;
+			if (!active && steps < FAR_UPDATE_INTERVAL) {
+				continue;
+			}
+		}
+		asteroid->updated = game->tick;
+		asteroid->far = !active;
+
+		asteroid->x += asteroid->dx * steps;
+		asteroid->y += asteroid->dy * steps;
+		if (asteroid->x >= REAL(game->world_width) - asteroid->radius) {
 			asteroid->dx = -asteroid->dx;
-			asteroid->x = game->width - asteroid->radius - GRACE_SPACING;
+			asteroid->x = REAL(game->world_width) - asteroid->radius - REAL(GRACE_SPACING);
 		}
 		if (asteroid->x <= asteroid->radius) {
 			asteroid->dx = -asteroid->dx;
-			asteroid->x = asteroid->radius + GRACE_SPACING;
+			asteroid->x = asteroid->radius + REAL(GRACE_SPACING);
 		}
-		if (asteroid->y >= game->height - asteroid->radius) {
+		if (asteroid->y >= REAL(game->world_height) - asteroid->radius) {
 			asteroid->dy = -asteroid->dy;
-			asteroid->y = game->height - asteroid->radius - GRACE_SPACING;
+			asteroid->y = REAL(game->world_height) - asteroid->radius - REAL(GRACE_SPACING);
 		}
 		if (asteroid->y <= asteroid->radius) {
 			asteroid->dy = -asteroid->dy;
-			asteroid->y = asteroid->radius + GRACE_SPACING;
+			asteroid->y = asteroid->radius + REAL(GRACE_SPACING);
 		}
+		asteroid_set(game, i, asteroid);
 	}
 }
 
-void handle_collisions(Game *game)
+bool handle_hits(Game *game)
 {
+	PROFILE_FUNCTION();
+	Bullet *bullets = game->bullets.items;
+
+	/*
+	 * Destroyed asteroids and bullets stay where they are until the end of the frame, and split
+	 * halves are only added then, so the indices below never move.
+	 */
+
 	// Asteroid-Player and Bullet-Asteroid collisions
-	for (int i = 0; i < game->n_asteroids; i++) {
-		Asteroid *asteroid = &game->asteroids[i];
-		float dx = game->player->x - asteroid->x;
-		float dy = game->player->y - asteroid->y;
-		float dist_sq = dx * dx + dy * dy;
-		float radius_sum = asteroid->radius + SHIP_RADIUS * 0.80f;
-		if (dist_sq <= radius_sum * radius_sum) {
-			game->state = GAME_OVER;
-			return;
+	Narrowphase *narrowphase = &game->narrowphase;
+	Uint64 spent[NARROWPHASE_BULLET_WORDS] = { 0 };
+
+	/* Far asteroids are away from the ship and from every bullet */
+	narrowphase_begin(narrowphase);
+	for (int i = 0; i < game->asteroids.count; i++) {
+		Asteroid asteroid = asteroid_get(game, i);
+		if (!asteroid.far) {
+			narrowphase_add(narrowphase, i, asteroid.x, asteroid.y, asteroid.radius);
+		}
+	}
+	narrowphase_end(narrowphase);
+	int crash = narrowphase_first_hit(narrowphase, game->player->x, game->player->y,
+									  REAL(SHIP_RADIUS * 0.80f));
+	for (int j = 0; j < game->bullets.count; j++) {
+		if (store_alive(&game->bullets, j)) {
+			narrowphase_test(narrowphase, j, bullets[j].x, bullets[j].y, REAL(BULLET_RADIUS));
 		}
-		for (int j = 0; j < game->n_bullets; j++) {
-			Bullet *bullet = &game->bullets[j];
-			float dx = bullet->x - asteroid->x;
-			float dy = bullet->y - asteroid->y;
-			float dist_sq = dx * dx + dy * dy;
-			float radius_sum = asteroid->radius + BULLET_RADIUS;
-			if (dist_sq <= radius_sum * radius_sum) {
-				game->bullets[j] = game->bullets[--game->n_bullets];
-				j--;
-
-				if (asteroid->radius < ASTEROID_SPLIT_THRESHOLD) {
-					game->asteroids[i--] = game->asteroids[--game->n_asteroids];
-					continue;
+	}
+
+	/*
+	 * Going through the asteroids in order, up to the one that hits the ship, each one is hit by
+	 * the lowest bullet that touches it and hasn't hit another one yet.
+	 */
+	int last = (crash == -1) ? narrowphase->count : crash;
+	for (int word = 0; word * 64 < last; word++) {
+		for (Uint64 bits = narrowphase->hit[word]; bits; bits &= bits - 1) {
+			int candidate = word * 64 + __builtin_ctzll(bits);
+			Uint64 *hits = &narrowphase->hits[candidate * NARROWPHASE_BULLET_WORDS];
+			int j = -1;
+
+			if (candidate >= last) {
+				break;
+			}
+			for (int w = 0; w < NARROWPHASE_BULLET_WORDS && j == -1; w++) {
+				if (hits[w] & ~spent[w]) {
+					j = w * 64 + __builtin_ctzll(hits[w] & ~spent[w]);
 				}
-				float vx = asteroid->dx;
-				float vy = asteroid->dy;
-				float module = SDL_sqrtf(vx * vx + vy * vy);
-				float nx = vx / module;
-				float ny = vy / module;
-
-#define sqrt2 1.41421356237f
-
-				game->asteroids[game->n_asteroids++] = game->asteroids[i + 1];
-				game->asteroids[i + 1]
-				  = (Asteroid){ .radius = asteroid->radius / sqrt2,
-								.x = asteroid->x + ny * asteroid->radius / sqrt2,
-								.y = asteroid->y - nx * asteroid->radius / sqrt2,
-								.dx = asteroid->dx + ny,
-								.dy = asteroid->dy - nx };
-				game->asteroids[i] = (Asteroid){ .radius = asteroid->radius / sqrt2,
-												 .x = asteroid->x - ny * asteroid->radius,
-												 .y = asteroid->y + nx * asteroid->radius,
-												 .dx = asteroid->dx - ny,
-												 .dy = asteroid->dy + nx };
-
-				i++;
 			}
+			if (j == -1) {
+				continue;
+			}
+			spent[j / 64] |= (Uint64)1 << (j % 64);
+			int index = narrowphase->asteroids[candidate];
+			Asteroid asteroid = asteroid_get(game, index);
+			emit_event(game, EVENT_HIT, game->asteroids.handles[index], game->bullets.handles[j],
+					   asteroid.x, asteroid.y, asteroid.radius);
+			store_destroy(&game->bullets, j);
+			break_asteroid(game, index);
 		}
 	}
+	if (crash != -1) {
+		int index = narrowphase->asteroids[crash];
+		Asteroid asteroid = asteroid_get(game, index);
+		emit_event(game, EVENT_CRASH, game->asteroids.handles[index], HANDLE_NONE, asteroid.x,
+				   asteroid.y, asteroid.radius);
+		game->state = GAME_OVER;
+		return true;
+	}
+
+	return false;
+}
 
-	// Asteroid-Asteroid collisions
-	for (int i = 0; i < game->n_asteroids; i++) {
-		Asteroid *a1 = &game->asteroids[i];
-		for (int j = i + 1; j < game->n_asteroids; j++) {
-			Asteroid *a2 = &game->asteroids[j];
-
-			float dx = a2->x - a1->x;  // (dx, dy) is the collision vector
-			float dy = a2->y - a1->y;
-			float dist_sq = dx * dx + dy * dy;
-			float radius_sum = a1->radius + a2->radius;
-
-			if (dist_sq < radius_sum * radius_sum) {
-				// collision <=> module of difference less than sum of radii
-				float dist = SDL_sqrtf(dist_sq);
-				if (dist == 0.0f)
-					continue;  // avoid division by zero
-
-				// Normalize it
-				float nx = dx / dist;
-				float ny = dy / dist;
-
-				// Push them apart in the opposite direction that they are colliding in
-				float overlap = 0.6f * (radius_sum - dist + 1.0f);
-				a1->x -= nx * overlap;
-				a1->y -= ny * overlap;
-				a2->x += nx * overlap;
-				a2->y += ny * overlap;
-
-				// (dvx, dvy) is the relative velocity
-				float dvx = a2->dx - a1->dx;
-				float dvy = a2->dy - a1->dy;
-
-				// Impact speed is the projection of the relative velocity on the collision vectors'
-				// direction
-				float impact_speed = dvx * nx + dvy * ny;
-				if (impact_speed > 0)
-					continue;
-
-				// Now that we have the speed impulse (impulse = speed because they are perfectly
-				// elastic), we apply it to the asteroids
-
-				// Ponderate the impulse by mass
-				float ponderation
-				  = a1->radius * a1->radius / (a1->radius * a1->radius + a2->radius * a2->radius);
-				a1->dx += nx * 2 * impact_speed * (1.0f - ponderation);
-				a1->dy += ny * 2 * impact_speed * (1.0f - ponderation);
-				a2->dx -= nx * 2 * impact_speed * ponderation;
-				a2->dy -= ny * 2 * impact_speed * ponderation;
+void collide_strip(Game *game, int strip)
+{
+	Grid *grid = &game->grid;
+	AsteroidData *asteroids = game->asteroids.items;
+	Uint8 tick = game->tick;
+	int tests = 0;
+
+	/*
+	 * Only asteroids updated this frame look for collisions, far ones that slept through it don't.
+	 * Every pair is resolved once, from its lowest updated asteroid. Destroyed asteroids aren't in
+	 * the grid. Strips go through their asteroids in order, so pairs sharing an asteroid are always
+	 * resolved in the same order.
+	 */
+	for (int k = grid->strip_start[strip]; k < grid->strip_start[strip + 1]; k++) {
+		int i = grid->strip_items[k];
+		if (asteroids[i].updated != tick) {
+			continue;
+		}
+		int column = grid->cells[i] % grid->columns;
+		int row = grid->cells[i] / grid->columns;
+		for (int r = SDL_max(row - 1, 0); r <= SDL_min(row + 1, grid->rows - 1); r++) {
+			for (int c = SDL_max(column - 1, 0); c <= SDL_min(column + 1, grid->columns - 1);
+				 c++) {
+				for (int j = grid->head[r * grid->columns + c]; j != -1; j = grid->next[j]) {
+					if (j == i || (j < i && asteroids[j].updated == tick)) {
+						continue;
+					}
+					/* Always the same orientation, whichever side finds the pair */
+					tests++;
+					Asteroid a1 = asteroid_get(game, SDL_min(i, j));
+					Asteroid a2 = asteroid_get(game, SDL_max(i, j));
+					if (collide_asteroids(game, &a1, &a2)) {
+						asteroid_set(game, SDL_min(i, j), &a1);
+						asteroid_set(game, SDL_max(i, j), &a2);
+					}
+				}
 			}
 		}
 	}
+	SDL_AddAtomicInt(&game->pair_tests, tests);
+}
+
+void ship_job(void *data, int begin, int end)
+{
+	update_player_position(data);
+}
+
+void bullets_job(void *data, int begin, int end)
+{
+	update_bullets_position(data, begin, end);
+}
+
+void activity_job(void *data, int begin, int end)
+{
+	destroy_lost_bullets(data);
+	mark_active(data);
+}
+
+void asteroids_job(void *data, int begin, int end)
+{
+	update_asteroids_position(data, begin, end);
+}
+
+void hits_job(void *data, int begin, int end)
+{
+	Game *game = data;
+
+	/* No asteroid-asteroid collisions once the ship crashed, nor every other cheap frame */
+	game->grid.built = !handle_hits(game) && !(game->cheap_collisions && game->tick % 2);
+}
+
+void locate_job(void *data, int begin, int end)
+{
+	Game *game = data;
+
+	if (game->grid.built) {
+		grid_locate(game, begin, end);
+	}
+}
+
+void sort_job(void *data, int begin, int end)
+{
+	Game *game = data;
+
+	if (game->grid.built) {
+		grid_sort(game);
+	}
+}
+
+void scatter_job(void *data, int begin, int end)
+{
+	Game *game = data;
+
+	if (game->grid.built) {
+		grid_scatter(game, begin, end);
+	}
+}
+
+void fill_job(void *data, int begin, int end)
+{
+	Game *game = data;
+
+	for (int strip = begin; strip < end && game->grid.built; strip++) {
+		grid_fill(game, strip);
+	}
+}
+
+void even_strips_job(void *data, int begin, int end)
+{
+	Game *game = data;
+
+	for (int i = begin; i < end && game->grid.built; i++) {
+		collide_strip(game, 2 * i);
+	}
+}
+
+void odd_strips_job(void *data, int begin, int end)
+{
+	Game *game = data;
+
+	for (int i = begin; i < end && game->grid.built; i++) {
+		collide_strip(game, 2 * i + 1);
+	}
+}
+
+void clear_job(void *data, int begin, int end)
+{
+	Game *game = data;
+
+	for (int strip = begin; strip < end && game->grid.built; strip++) {
+		grid_clear(game, strip);
+	}
+}
+
+void break_asteroid(Game *game, int index)
+{
+	Asteroid unpacked = asteroid_get(game, index);
+	Asteroid *asteroid = &unpacked;
+
+	store_destroy(&game->asteroids, index);
+	if (asteroid->radius < REAL(ASTEROID_SPLIT_THRESHOLD) || store_room(&game->asteroids) < 2) {
+		emit_event(game, EVENT_DESTROYED, game->asteroids.handles[index], HANDLE_NONE, asteroid->x,
+				   asteroid->y, asteroid->radius);
+		return;
+	}
+	emit_event(game, EVENT_SPLIT, game->asteroids.handles[index], HANDLE_NONE, asteroid->x,
+			   asteroid->y, asteroid->radius);
+	Real vx = asteroid->dx;
+	Real vy = asteroid->dy;
+	Real module = real_sqrt((RealWide)vx * vx + (RealWide)vy * vy);
+	/* Collisions can stop an asteroid dead, it then splits sideways */
+	Real nx = (module != 0) ? REAL_DIV(vx, module) : REAL(1);
+	Real ny = (module != 0) ? REAL_DIV(vy, module) : 0;
+	Real side_x = REAL_MUL(ny, asteroid->radius);
+	Real side_y = REAL_MUL(nx, asteroid->radius);
+
+#define sqrt2 REAL(1.41421356237f)
+
+	asteroid_create(game, &(Asteroid){ .radius = REAL_DIV(asteroid->radius, sqrt2),
+									   .x = asteroid->x + REAL_DIV(side_x, sqrt2),
+									   .y = asteroid->y - REAL_DIV(side_y, sqrt2),
+									   .dx = asteroid->dx + ny,
+									   .dy = asteroid->dy - nx,
+									   .updated = asteroid->updated });
+	asteroid_create(game, &(Asteroid){ .radius = REAL_DIV(asteroid->radius, sqrt2),
+									   .x = asteroid->x - side_x,
+									   .y = asteroid->y + side_y,
+									   .dx = asteroid->dx - ny,
+									   .dy = asteroid->dy + nx,
+									   .updated = asteroid->updated });
+}
+
+bool collide_asteroids(Game *game, Asteroid *a1, Asteroid *a2)
+{
+	Real dx = a2->x - a1->x;  // (dx, dy) is the collision vector
+	Real dy = a2->y - a1->y;
+	RealWide dist_sq = (RealWide)dx * dx + (RealWide)dy * dy;
+	Real radius_sum = a1->radius + a2->radius;
+
+	if (dist_sq >= (RealWide)radius_sum * radius_sum) {
+		return false;
+	}
+
+	// collision <=> module of difference less than sum of radii
+	Real dist = real_sqrt(dist_sq);
+	if (dist == 0)
+		return false;  // avoid division by zero
+
+	// Normalize it
+	Real nx = REAL_DIV(dx, dist);
+	Real ny = REAL_DIV(dy, dist);
+
+	// Push them apart in the opposite direction that they are colliding in
+	Real overlap = REAL_MUL(REAL(0.6f), radius_sum - dist + REAL(1));
+	a1->x -= REAL_MUL(nx, overlap);
+	a1->y -= REAL_MUL(ny, overlap);
+	a2->x += REAL_MUL(nx, overlap);
+	a2->y += REAL_MUL(ny, overlap);
+	/* Being pushed can't take them out of the world */
+	clamp_asteroid_position(game, a1);
+	clamp_asteroid_position(game, a2);
+
+	// (dvx, dvy) is the relative velocity
+	Real dvx = a2->dx - a1->dx;
+	Real dvy = a2->dy - a1->dy;
+
+	// Impact speed is the projection of the relative velocity on the collision vectors'
+	// direction
+	Real impact_speed = REAL_MUL(dvx, nx) + REAL_MUL(dvy, ny);
+	if (impact_speed > 0)
+		return true;
+
+	// Now that we have the speed impulse (impulse = speed because they are perfectly
+	// elastic), we apply it to the asteroids
+
+	// Ponderate the impulse by mass
+	Real mass1 = REAL_MUL(a1->radius, a1->radius);
+	Real ponderation = REAL_DIV(mass1, mass1 + REAL_MUL(a2->radius, a2->radius));
+	a1->dx += REAL_MUL(REAL_MUL(nx * 2, impact_speed), REAL(1) - ponderation);
+	a1->dy += REAL_MUL(REAL_MUL(ny * 2, impact_speed), REAL(1) - ponderation);
+	a2->dx -= REAL_MUL(REAL_MUL(nx * 2, impact_speed), ponderation);
+	a2->dy -= REAL_MUL(REAL_MUL(ny * 2, impact_speed), ponderation);
+	return true;
 }
 
 void create_asteroids(Game *game)
 {
+	PROFILE_FUNCTION();
+	Grid *grid = &game->grid;
+	Asteroid wave[MAX_ASTEROIDS];
 	int n_asteroids = (game->level + MIN_ASTEROIDS >= MAX_ASTEROIDS)
 						? MAX_ASTEROIDS
 						: (game->level + MIN_ASTEROIDS);
+	int deepest = SDL_max(game->world_width, game->world_height) / 2;
+	int band = SPAWN_BAND;
+	int placed = 0;
+
+	/*
+	 * Random places are tried until one is clear, the grid finding the asteroids around it. It is
+	 * empty between frames. When the band is too crowded it gets deeper, so an asteroid only goes
+	 * missing from the wave if the whole world is full.
+	 */
+	n_asteroids = SDL_min(n_asteroids, game->asteroids.capacity);
 	for (int i = 0; i < n_asteroids; i++) {
-		Asteroid *asteroid = &game->asteroids[game->n_asteroids++];
-		asteroid->radius
-		  = rand() % (ASTEROID_RADIUS_MAX - ASTEROID_RADIUS_MIN + 1) + ASTEROID_RADIUS_MIN;
-		enum { TOP, RIGHT, BOTTOM, LEFT };
-		int side = rand() % 4;
-		switch (side) {
-		case TOP:
-			asteroid->x = rand() % (int)(game->width) + asteroid->radius;
-			asteroid->y = asteroid->radius + GRACE_SPACING;
-			break;
-		case RIGHT:
-			asteroid->x = game->width - asteroid->radius - GRACE_SPACING;
-			asteroid->y = rand() % (int)(game->height - 2 * asteroid->radius) + asteroid->radius;
-			break;
-		case BOTTOM:
-			asteroid->x = rand() % (int)(game->width - 2 * asteroid->radius) + asteroid->radius;
-			asteroid->y = game->height - asteroid->radius - GRACE_SPACING;
-			break;
-		case LEFT:
-			asteroid->x = asteroid->radius + GRACE_SPACING;
-			asteroid->y = rand() % (int)(game->height - 2 * asteroid->radius) + asteroid->radius;
-			break;
+		Asteroid *asteroid = &wave[placed];
+		int radius = rand() % (ASTEROID_RADIUS_MAX - ASTEROID_RADIUS_MIN + 1) + ASTEROID_RADIUS_MIN;
+		bool fits = false;
+
+		asteroid->radius = REAL(radius);
+		for (int attempt = 1; !fits; attempt++) {
+			if (attempt > SPAWN_ATTEMPTS) {
+				if (band >= deepest) {
+					break;
+				}
+				band += SPAWN_BAND;
+				attempt = 1;
+			}
+			spawn_position(game, asteroid, band);
+			fits = spawn_fits(game, wave, asteroid);
+		}
+		if (!fits) {
+			continue;
 		}
-		asteroid->dx = rand() % (ASTEROID_SPEED_MAX - ASTEROID_SPEED_MIN + 1) + ASTEROID_SPEED_MIN;
-		asteroid->dy = rand() % (ASTEROID_SPEED_MAX - ASTEROID_SPEED_MIN + 1) + ASTEROID_SPEED_MIN;
+		asteroid->dx
+		  = REAL(rand() % (ASTEROID_SPEED_MAX - ASTEROID_SPEED_MIN + 1) + ASTEROID_SPEED_MIN);
+		asteroid->dy
+		  = REAL(rand() % (ASTEROID_SPEED_MAX - ASTEROID_SPEED_MIN + 1) + ASTEROID_SPEED_MIN);
+		asteroid->updated = game->tick;
+		asteroid->far = false;
+
+		int cell = grid_cell(grid, asteroid->x, asteroid->y);
+		grid->next[placed] = grid->head[cell];
+		grid->head[cell] = placed++;
+	}
+
+	for (int i = 0; i < placed; i++) {
+		grid->head[grid_cell(grid, wave[i].x, wave[i].y)] = -1;
+		asteroid_create(game, &wave[i]);
+	}
+}
+
+void spawn_position(Game *game, Asteroid *asteroid, int band)
+{
+	int radius = (int)REAL_FLOAT(asteroid->radius);
+	enum { TOP, RIGHT, BOTTOM, LEFT };
+	int side = rand() % 4;
+	/* Never past the other edge */
+	int across = (side == TOP || side == BOTTOM) ? game->world_height : game->world_width;
+	int depth = rand() % SDL_max(SDL_min(band, across - 2 * (radius + GRACE_SPACING)), 1);
+
+	switch (side) {
+	case TOP:
+		asteroid->x = REAL(rand() % (game->world_width - 2 * radius) + radius);
+		asteroid->y = REAL(radius + GRACE_SPACING + depth);
+		break;
+	case RIGHT:
+		asteroid->x = REAL(game->world_width - radius - GRACE_SPACING - depth);
+		asteroid->y = REAL(rand() % (game->world_height - 2 * radius) + radius);
+		break;
+	case BOTTOM:
+		asteroid->x = REAL(rand() % (game->world_width - 2 * radius) + radius);
+		asteroid->y = REAL(game->world_height - radius - GRACE_SPACING - depth);
+		break;
+	case LEFT:
+		asteroid->x = REAL(radius + GRACE_SPACING + depth);
+		asteroid->y = REAL(rand() % (game->world_height - 2 * radius) + radius);
+		break;
+	}
+}
+
+bool spawn_fits(Game *game, const Asteroid *wave, const Asteroid *asteroid)
+{
+	Grid *grid = &game->grid;
+	Player *player = game->player;
+	Real dx = asteroid->x - player->x;
+	Real dy = asteroid->y - player->y;
+	Real clearance = REAL(SPAWN_CLEARANCE) + asteroid->radius;
+
+	if ((RealWide)dx * dx + (RealWide)dy * dy < (RealWide)clearance * clearance) {
+		return false;
+	}
+
+	/* Cells are as wide as two radii at most, asteroids it could touch are in the ones around */
+	int column = grid_cell(grid, asteroid->x, asteroid->y) % grid->columns;
+	int row = grid_cell(grid, asteroid->x, asteroid->y) / grid->columns;
+	for (int r = SDL_max(row - 1, 0); r <= SDL_min(row + 1, grid->rows - 1); r++) {
+		for (int c = SDL_max(column - 1, 0); c <= SDL_min(column + 1, grid->columns - 1); c++) {
+			for (int j = grid->head[r * grid->columns + c]; j != -1; j = grid->next[j]) {
+				Real ex = wave[j].x - asteroid->x;
+				Real ey = wave[j].y - asteroid->y;
+				Real gap = wave[j].radius + asteroid->radius;
+				if ((RealWide)ex * ex + (RealWide)ey * ey <= (RealWide)gap * gap) {
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+void clamp_asteroid_position(Game *game, Asteroid *asteroid)
+{
+	if (asteroid->x >= REAL(game->world_width) - asteroid->radius) {
+		asteroid->x = REAL(game->world_width) - asteroid->radius - REAL(GRACE_SPACING);
+	}
+	if (asteroid->x <= asteroid->radius) {
+		asteroid->x = asteroid->radius + REAL(GRACE_SPACING);
+	}
+	if (asteroid->y >= REAL(game->world_height) - asteroid->radius) {
+		asteroid->y = REAL(game->world_height) - asteroid->radius - REAL(GRACE_SPACING);
+	}
+	if (asteroid->y <= asteroid->radius) {
+		asteroid->y = asteroid->radius + REAL(GRACE_SPACING);
+	}
+}
+
+int grid_cell(Grid *grid, Real x, Real y)
+{
+	int column = SDL_clamp((int)(x / REAL(GRID_CELL)), 0, grid->columns - 1);
+	int row = SDL_clamp((int)(y / REAL(GRID_CELL)), 0, grid->rows - 1);
+	return row * grid->columns + column;
+}
+
+bool grid_is_active(Grid *grid, Real x, Real y)
+{
+	int column = SDL_clamp((int)(x / REAL(ACTIVE_DISTANCE)), 0, grid->active_columns - 1);
+	int row = SDL_clamp((int)(y / REAL(ACTIVE_DISTANCE)), 0, grid->active_rows - 1);
+	return grid->active[row * grid->active_columns + column];
+}
+
+void grid_mark_active(Grid *grid, Real x, Real y, Real w, Real h)
+{
+	/* A Real over a Real is a plain number in both builds, cut down to the cell */
+	int first_column
+	  = SDL_clamp((int)(x / REAL(ACTIVE_DISTANCE)), 0, grid->active_columns - 1);
+	int last_column
+	  = SDL_clamp((int)((x + w) / REAL(ACTIVE_DISTANCE)), 0, grid->active_columns - 1);
+	int first_row = SDL_clamp((int)(y / REAL(ACTIVE_DISTANCE)), 0, grid->active_rows - 1);
+	int last_row = SDL_clamp((int)((y + h) / REAL(ACTIVE_DISTANCE)), 0, grid->active_rows - 1);
+
+	for (int row = first_row; row <= last_row; row++) {
+		SDL_memset(&grid->active[row * grid->active_columns + first_column], 1,
+				   last_column - first_column + 1);
+	}
+}
+
+void grid_locate(Game *game, int begin, int end)
+{
+	Grid *grid = &game->grid;
+	int *counts = &grid->strip_counts[begin / ASTEROID_JOB_SIZE * grid->strips];
+
+	SDL_memset(counts, 0, grid->strips * sizeof(int));
+	for (int i = begin; i < end; i++) {
+		Asteroid asteroid = asteroid_get(game, i);
+		int cell = grid_cell(grid, asteroid.x, asteroid.y);
+		grid->cells[i] = cell;
+		if (store_alive(&game->asteroids, i)) {
+			counts[cell % grid->columns / STRIP_COLUMNS]++;
+		}
+	}
+}
+
+void grid_sort(Game *game)
+{
+	Grid *grid = &game->grid;
+	int n_jobs = (game->asteroids.count + ASTEROID_JOB_SIZE - 1) / ASTEROID_JOB_SIZE;
+	int start = 0;
+
+	/* Strip by strip, and within a strip job by job, so every asteroid keeps its order */
+	for (int strip = 0; strip < grid->strips; strip++) {
+		grid->strip_start[strip] = start;
+		for (int job = 0; job < n_jobs; job++) {
+			int *count = &grid->strip_counts[job * grid->strips + strip];
+			int n = *count;
+			*count = start;
+			start += n;
+		}
+	}
+	grid->strip_start[grid->strips] = start;
+}
+
+void grid_scatter(Game *game, int begin, int end)
+{
+	Grid *grid = &game->grid;
+	int *next = &grid->strip_counts[begin / ASTEROID_JOB_SIZE * grid->strips];
+
+	for (int i = begin; i < end; i++) {
+		if (store_alive(&game->asteroids, i)) {
+			grid->strip_items[next[grid->cells[i] % grid->columns / STRIP_COLUMNS]++] = i;
+		}
+	}
+}
+
+void grid_fill(Game *game, int strip)
+{
+	Grid *grid = &game->grid;
+
+	for (int k = grid->strip_start[strip]; k < grid->strip_start[strip + 1]; k++) {
+		int i = grid->strip_items[k];
+		grid->next[i] = grid->head[grid->cells[i]];
+		grid->head[grid->cells[i]] = i;
+	}
+}
+
+void grid_clear(Game *game, int strip)
+{
+	Grid *grid = &game->grid;
+
+	for (int k = grid->strip_start[strip]; k < grid->strip_start[strip + 1]; k++) {
+		grid->head[grid->cells[grid->strip_items[k]]] = -1;
 	}
 }
@@ -3,9 +3,67 @@
 
 #include <stdbool.h>
 
+#include <SDL3/SDL_atomic.h>
 #include <SDL3/SDL_render.h>
 
 #include "config.h"
+#include "events.h"
+#include "narrowphase.h"
+#include "real.h"
+#include "store.h"
+
+/**
+ * Maximum number of asteroids alive at the same time. Every asteroid of a wave can split once.
+ */
+#define ASTEROID_CAPACITY (2 * MAX_ASTEROIDS)
+/**
+ * Side of the cells of the spatial grid. Asteroids that touch are always in neighbouring cells.
+ */
+#define GRID_CELL (2 * ASTEROID_RADIUS_MAX)
+/**
+ * Depth of the band along the edges of the world that waves spawn in. It gets deeper by as much
+ * each time it is too crowded to fit the next asteroid.
+ */
+#define SPAWN_BAND (2 * ASTEROID_RADIUS_MAX)
+/**
+ * Places tried in the band for an asteroid before it gets deeper
+ */
+#define SPAWN_ATTEMPTS 32
+/**
+ * Distance from the ship that asteroids spawn further than, edge to center
+ */
+#define SPAWN_CLEARANCE (8 * SHIP_RADIUS)
+#ifdef COMPACT
+#ifndef FIXED_POINT
+#error "Compact asteroids are packed from fixed point numbers, build with FIXED_POINT too"
+#endif
+/**
+ * Bits dropped from the velocities of compact asteroids, they are kept in 1/2048th of a pixel
+ */
+#define COMPACT_SPEED_SHIFT 1
+/**
+ * Bits dropped from the radii of compact asteroids, they are kept in quarters of a pixel
+ */
+#define COMPACT_RADIUS_SHIFT 10
+#endif
+
+/**
+ * Grid columns in a collision strip, at least 2. A strip only touches asteroids in its columns and
+ * the ones next to them, so strips two apart never touch the same ones and run at the same time.
+ */
+#define STRIP_COLUMNS 4
+/**
+ * Bullets moved by one job
+ */
+#define BULLET_JOB_SIZE 256
+/**
+ * Asteroids moved by one job
+ */
+#define ASTEROID_JOB_SIZE 2048
+/**
+ * Asteroids a collision job looks for collisions for, on average
+ */
+#define COLLISION_JOB_SIZE 1024
 
 /**
  * How the direction of the player is changing.
@@ -21,6 +79,25 @@ typedef enum { CONSTANT, DECELERATING, ACCELERATING } AccelerationState;
  */
 typedef enum { MENU, PLAY, PAUSE, GAME_OVER } GameState;
 
+/**
+ * Actions the player can take.
+ */
+typedef enum { INPUT_LEFT, INPUT_RIGHT, INPUT_THRUST, INPUT_BRAKE, INPUT_FIRE } InputAction;
+
+/**
+ * Maximum number of inputs that can wait for the next frame. More are dropped.
+ */
+#define INPUT_QUEUE_SIZE 64
+
+/**
+ * A key press or release, waiting for the next frame to apply it.
+ */
+typedef struct {
+	Uint64 timestamp;	/**< When it happened, in ns */
+	InputAction action; /**< What the player did */
+	bool down;			/**< Whether the key was pressed or released */
+} InputEvent;
+
 /**
  * Used to distinguish the ship's vertices when rendering it.
  */
@@ -32,10 +109,12 @@ enum { BOW = 0, STARBOARD, PORT, AFT };
 typedef struct Ship {
 	unsigned int direction;				  /**< Direction of the ship as a 0-360 value */
 	DirectionState direction_state;		  /**< How the ship is turning */
-	float x;							  /**< X position of the ship */
-	float y;							  /**< Y position of the ship */
-	float velocity;						  /**< Velocity of the ship */
+	Real x;								  /**< X position of the ship */
+	Real y;								  /**< Y position of the ship */
+	Real velocity;						  /**< Velocity of the ship */
 	AccelerationState acceleration_state; /**< How the ship is accelerating */
+	DirectionState tap_direction;		  /**< Last turn pressed since the last frame */
+	AccelerationState tap_acceleration;	  /**< Same, for the acceleration */
 	SDL_Vertex vertices[4];				  /**< Vertices of the ship, to render it */
 	int indices[6];						  /**< Indices of the vertices of the ship to render in */
 } Player;
@@ -44,38 +123,183 @@ typedef struct Ship {
  * Represents an asteroid
  */
 typedef struct Asteroid {
-	float x;	  /**< X position of the asteroid */
-	float y;	  /**< Y position of the asteroid */
-	float radius; /**< Radius of the asteroid */
-	float dx;	  /**< X velocity of the asteroid */
-	float dy;	  /**< Y velocity of the asteroid */
+	Real x;		   /**< X position of the asteroid */
+	Real y;		   /**< Y position of the asteroid */
+	Real radius;   /**< Radius of the asteroid */
+	Real dx;	   /**< X velocity of the asteroid */
+	Real dy;	   /**< Y velocity of the asteroid */
+	Uint8 updated; /**< Last frame it was updated on, modulo 256 */
+	bool far;	   /**< Far from the view and the bullets, so it is updated less often */
 } Asteroid;
 
+#ifdef COMPACT
+/**
+ * An asteroid as the store keeps it in compact builds (make COMPACT=1), half the size of an
+ * Asteroid. Positions are 16 bits across the world, in steps of a power of two fraction of a pixel
+ * that depends on its size, velocities and radii are cut to the bits they need. The simulation
+ * unpacks them as it goes through them and packs back what it changed, see asteroid_get().
+ */
+typedef struct {
+	Uint16 x;	   /**< X position, in steps of 1 << position_shift Reals */
+	Uint16 y;	   /**< Y position, same */
+	Sint16 dx;	   /**< X velocity, in steps of 1 << COMPACT_SPEED_SHIFT Reals */
+	Sint16 dy;	   /**< Y velocity, same */
+	Uint8 radius;  /**< Radius, in steps of 1 << COMPACT_RADIUS_SHIFT Reals */
+	Uint8 updated; /**< Last frame it was updated on, modulo 256 */
+	bool far;	   /**< Far from the view and the bullets, so it is updated less often */
+} AsteroidData;
+#else
+/**
+ * An asteroid as the store keeps it, as it is.
+ */
+typedef Asteroid AsteroidData;
+#endif
+
 /**
  * Represents a bullet
  */
 typedef struct Bullet {
-	float x;  /**< X position of the bullet */
-	float y;  /**< Y position of the bullet */
-	float dx; /**< X velocity of the bullet */
-	float dy; /**< Y velocity of the bullet */
+	Real x;	 /**< X position of the bullet */
+	Real y;	 /**< Y position of the bullet */
+	Real dx; /**< X velocity of the bullet */
+	Real dy; /**< Y velocity of the bullet */
 } Bullet;
 
+/**
+ * Uniform grid over the world. Finds asteroids close to each other, and tells which parts of the
+ * world are active. Rebuilt every frame, and emptied after use.
+ *
+ * Asteroids are also sorted into strips of STRIP_COLUMNS columns, so that strips can be filled
+ * and resolved in parallel. Each strip goes through its asteroids in order, so the cells and the
+ * collisions come out the same whichever thread handles it.
+ */
+typedef struct {
+	int columns;		/**< Cells along X */
+	int rows;			/**< Cells along Y */
+	int active_columns;	/**< Activity cells along X, they are ACTIVE_DISTANCE wide */
+	int active_rows;	/**< Activity cells along Y */
+	Uint8* active;		/**< Whether each activity cell is close to the view or to a bullet */
+	int* head;			/**< First asteroid of each cell, -1 if empty */
+	int* next;			/**< Next asteroid in the same cell as each asteroid, -1 if last */
+	int* cells;			/**< Cell of every asteroid */
+	int strips;			/**< Number of strips */
+	int* strip_start;	/**< First asteroid of each strip in strip_items, and one past the last */
+	int* strip_counts;	/**< Asteroids of each strip in each job, then where they go in strip_items */
+	int* strip_items;	/**< Asteroids alive, by strip and by index */
+	bool built;			/**< Whether the cells are filled this frame */
+} Grid;
+
 /**
  * Stores all the information the game needs to emulate.
  */
 typedef struct {
-	int width;			 /**< Width of the window */
-	int height;			 /**< Height of the window */
-	Player* player;		 /**< Player of the game */
-	Asteroid* asteroids; /**< List with all the asteroids of the game */
-	int n_asteroids;	 /**< Number of asteroids in the game */
-	Bullet* bullets;	 /**< List with all the bullets of the game */
-	int n_bullets;		 /**< Number of bullets in the game */
-	unsigned int level;	 /**< Current level */
-	GameState state;	 /**< State of the game (menu, play, pause, game over) */
+	int width;				  /**< Width of the window */
+	int height;				  /**< Height of the window */
+	int world_width;		  /**< Width of the world, the window only shows part of it */
+	int world_height;		  /**< Height of the world */
+	Player* player;			  /**< Player of the game */
+	Store asteroids;		  /**< Every asteroid of the game, its items are AsteroidData */
+	Store bullets;			  /**< Every bullet of the game, its items are Bullet */
+	unsigned int level;		  /**< Current level */
+	GameState state;		  /**< State of the game (menu, play, pause, game over) */
+	Uint64 tick;			  /**< Number of frames simulated */
+	bool cheap_collisions;	  /**< Resolve asteroid-asteroid collisions only every other frame */
+	Grid grid;				  /**< Spatial grid over the world */
+	Narrowphase narrowphase;  /**< Scratch space for the ship and bullet hit tests */
+	EventRing events;		  /**< What happened in the game, for readers outside of it */
+	SDL_AtomicInt pair_tests; /**< Asteroid pairs tested for collisions in the last frame */
+
+	InputEvent inputs[INPUT_QUEUE_SIZE]; /**< Inputs waiting for the next frame, oldest first */
+	int n_inputs;						 /**< Number of inputs waiting */
+	Uint64 time;						 /**< Time of the next frame, same clock as inputs */
+#ifdef COMPACT
+	int position_shift; /**< Bits dropped from the positions of compact asteroids */
+#endif
 } Game;
 
+#ifdef COMPACT
+/**
+ * Packs a number into fewer bits, to the nearest step, saturating past the ends.
+ */
+static inline Sint32 compact_pack(Real value, int shift, Sint32 min, Sint32 max)
+{
+	Sint32 packed = (Sint32)(((Sint64)value + ((1 << shift) >> 1)) >> shift);
+	return SDL_clamp(packed, min, max);
+}
+#endif
+
+/**
+ * Reads an asteroid of the store.
+ *
+ * @param game The game
+ * @param index Index of the asteroid in the store
+ * @return The asteroid, unpacked in compact builds
+ */
+static inline Asteroid asteroid_get(const Game* game, int index)
+{
+	const AsteroidData* data = &((const AsteroidData*)game->asteroids.items)[index];
+#ifdef COMPACT
+	return (Asteroid){ .x = (Real)data->x << game->position_shift,
+					   .y = (Real)data->y << game->position_shift,
+					   .radius = (Real)data->radius << COMPACT_RADIUS_SHIFT,
+					   .dx = (Real)data->dx * (1 << COMPACT_SPEED_SHIFT),
+					   .dy = (Real)data->dy * (1 << COMPACT_SPEED_SHIFT),
+					   .updated = data->updated,
+					   .far = data->far };
+#else
+	return *data;
+#endif
+}
+
+/**
+ * Packs an asteroid the way the store keeps it.
+ *
+ * @param game The game
+ * @param asteroid The asteroid
+ * @return What the store keeps of it
+ */
+static inline AsteroidData asteroid_pack(const Game* game, const Asteroid* asteroid)
+{
+#ifdef COMPACT
+	return (AsteroidData){
+		.x = compact_pack(asteroid->x, game->position_shift, 0, SDL_MAX_UINT16),
+		.y = compact_pack(asteroid->y, game->position_shift, 0, SDL_MAX_UINT16),
+		.dx = compact_pack(asteroid->dx, COMPACT_SPEED_SHIFT, SDL_MIN_SINT16, SDL_MAX_SINT16),
+		.dy = compact_pack(asteroid->dy, COMPACT_SPEED_SHIFT, SDL_MIN_SINT16, SDL_MAX_SINT16),
+		.radius = compact_pack(asteroid->radius, COMPACT_RADIUS_SHIFT, 0, SDL_MAX_UINT8),
+		.updated = asteroid->updated,
+		.far = asteroid->far
+	};
+#else
+	return *asteroid;
+#endif
+}
+
+/**
+ * Writes an asteroid back into the store.
+ *
+ * @param game The game
+ * @param index Index of the asteroid in the store
+ * @param asteroid The asteroid, packed again in compact builds
+ */
+static inline void asteroid_set(Game* game, int index, const Asteroid* asteroid)
+{
+	((AsteroidData*)game->asteroids.items)[index] = asteroid_pack(game, asteroid);
+}
+
+/**
+ * Adds an asteroid to the store, at the end of the frame like store_create().
+ *
+ * @param game The game
+ * @param asteroid The asteroid, packed in compact builds
+ * @return Handle of the asteroid, HANDLE_NONE if the store is full
+ */
+static inline Handle asteroid_create(Game* game, const Asteroid* asteroid)
+{
+	AsteroidData data = asteroid_pack(game, asteroid);
+	return store_create(&game->asteroids, &data);
+}
+
 /**
  * Creates a game, initializes its values and stores it in a pointer.
  *
@@ -85,7 +309,23 @@ typedef struct {
 bool game_init(Game** game);
 
 /**
- * Updates the state of the game by one frame.
+ * Creates a game in a world of another size, with room for another number of asteroids. Meant to
+ * benchmark far bigger fields than any level spawns.
+ *
+ * @param game Pointer to the game we want to create
+ * @param world_width Width of the world
+ * @param world_height Height of the world
+ * @param asteroid_capacity Asteroids alive at the same time at most
+ * @return True if the game was created successfully, false otherwise
+ */
+bool game_init_field(Game** game, int world_width, int world_height, int asteroid_capacity);
+
+/**
+ * Updates the state of the game by one frame. Asteroids and bullets created or destroyed during
+ * the frame are added or removed at its end, all at once.
+ *
+ * The frame is split into stages run by the job system. The result doesn't depend on how many
+ * threads run them.
  *
  * @param game Pointer to the game we want to update
  * @return True if the game was updated successfully, false otherwise
@@ -93,7 +333,19 @@ bool game_init(Game** game);
 bool game_update_frame(Game* game);
 
 /**
- * Makes the player shoot a bullet.
+ * Queues an input to be applied at the start of the next frame. Inputs must be queued in the order
+ * they happened.
+ *
+ * @param game Pointer to the game we want to update
+ * @param action What the player did
+ * @param down Whether the key was pressed or released
+ * @param timestamp When it happened, in ns
+ * @return True if the input was queued, false if the queue is full
+ */
+bool game_input(Game* game, InputAction action, bool down, Uint64 timestamp);
+
+/**
+ * Makes the player shoot a bullet right now. Not to be called while a frame is being updated.
  *
  * @param game Pointer to the game we want to update
  * @return True if the bullet was shot successfully, false otherwise
@@ -101,12 +353,20 @@ bool game_update_frame(Game* game);
 bool game_shoot(Game* game);
 
 /**
- * Resizes the game window and updates position to deal with it.
+ * Resizes the game window. The world stays the same size.
  *
  * @param game Pointer to the game we want to update
  */
 void game_resize(Game* game);
 
+/**
+ * Computes which part of the world is shown in the window. It follows the ship.
+ *
+ * @param game Pointer to the game
+ * @param view Rectangle of the world, in world coordinates, that the window shows
+ */
+void game_view(Game *game, SDL_FRect *view);
+
 /**
  * Frees the memory used by the game.
  *
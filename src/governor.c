@@ -0,0 +1,66 @@
+#include "governor.h"
+
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_timer.h>
+
+#include "config.h"
+
+/**
+ * Names of the tiers, for the log
+ */
+static const char *tier_names[] = { "full", "circles", "collisions" };
+
+void governor_init(Governor *governor)
+{
+	SDL_zerop(governor);
+	governor->tier = QUALITY_FULL;
+}
+
+/**
+ * Moves the governor to another tier and logs it.
+ */
+static void governor_set_tier(Governor *governor, QualityTier tier, double average_ms)
+{
+	SDL_Log("[%llu ms] Quality %s -> %s, frames took %.2f ms of %.2f ms",
+			(unsigned long long)SDL_GetTicks(), tier_names[governor->tier], tier_names[tier],
+			average_ms, 1000.0 / FPS);
+	governor->tier = tier;
+	governor->n_costs = 0;
+	governor->low_windows = 0;
+}
+
+bool governor_update(Governor *governor, Uint64 cost_ns)
+{
+	Uint64 total = 0;
+	double average_ms;
+	double budget_ms = 1000.0 / FPS;
+
+	governor->costs[governor->n_costs++] = cost_ns;
+	if (governor->n_costs < GOVERNOR_WINDOW) {
+		return false;
+	}
+
+	/* A whole window has been recorded since the last decision */
+	for (int i = 0; i < GOVERNOR_WINDOW; i++) {
+		total += governor->costs[i];
+	}
+	governor->n_costs = 0;
+	average_ms = (double)total / GOVERNOR_WINDOW / SDL_NS_PER_MS;
+
+	if (average_ms > budget_ms * GOVERNOR_HIGH) {
+		governor->low_windows = 0;
+		if (governor->tier < QUALITY_COLLISIONS) {
+			governor_set_tier(governor, governor->tier + 1, average_ms);
+			return true;
+		}
+	} else if (average_ms < budget_ms * GOVERNOR_LOW) {
+		if (++governor->low_windows >= GOVERNOR_RECOVERY && governor->tier > QUALITY_FULL) {
+			governor_set_tier(governor, governor->tier - 1, average_ms);
+			return true;
+		}
+	} else {
+		governor->low_windows = 0;
+	}
+
+	return false;
+}
@@ -0,0 +1,60 @@
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+#include <stdbool.h>
+
+#include <SDL3/SDL_stdinc.h>
+
+/**
+ * @brief Frames averaged to decide whether the budget is being held
+ */
+#define GOVERNOR_WINDOW 30
+/**
+ * @brief Fraction of the frame budget above which quality is lowered
+ */
+#define GOVERNOR_HIGH 0.9
+/**
+ * @brief Fraction of the frame budget below which quality is raised again
+ */
+#define GOVERNOR_LOW 0.5
+/**
+ * @brief Windows the cost has to stay low before quality is raised, so it doesn't oscillate
+ */
+#define GOVERNOR_RECOVERY 4
+
+/**
+ * Quality tiers, in the order they are given up when frames take too long.
+ */
+typedef enum {
+	QUALITY_FULL,		/**< Everything on */
+	QUALITY_CIRCLES,	/**< Circles are drawn as coarse polygons */
+	QUALITY_COLLISIONS, /**< Asteroid-asteroid collisions are resolved every other frame */
+} QualityTier;
+
+/**
+ * Watches the cost of the last frames against the FPS budget and picks a quality tier.
+ */
+typedef struct {
+	QualityTier tier;				/**< Current tier */
+	Uint64 costs[GOVERNOR_WINDOW];	/**< Cost of the last frames, in ns */
+	int n_costs;					/**< Frames recorded since the last tier change */
+	int low_windows;				/**< Consecutive windows below GOVERNOR_LOW */
+} Governor;
+
+/**
+ * Starts a governor at full quality.
+ *
+ * @param governor The governor to initialize
+ */
+void governor_init(Governor *governor);
+
+/**
+ * Records the cost of a frame, and changes tier if needed. Every change is logged.
+ *
+ * @param governor The governor to update
+ * @param cost_ns Time spent on the frame, without the frame cap delay
+ * @return True if the tier changed, false otherwise
+ */
+bool governor_update(Governor *governor, Uint64 cost_ns);
+
+#endif	// !GOVERNOR_H
@@ -0,0 +1,350 @@
+#include "jobs.h"
+
+#include <SDL3/SDL_assert.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_mutex.h>
+#include <SDL3/SDL_thread.h>
+
+#include "profile.h"
+
+/**
+ * Some items of a stage.
+ */
+typedef struct {
+	JobGraph *graph; /**< Graph the stage belongs to */
+	JobStage *stage; /**< Stage to run */
+	int begin;		 /**< First item */
+	int end;		 /**< One past the last item */
+} Job;
+
+/**
+ * Jobs queued by one thread. It pushes and pops at the bottom, other threads steal from the top.
+ */
+typedef struct {
+	SDL_SpinLock lock;		   /**< Protects the whole queue */
+	int top;				   /**< Oldest job */
+	int bottom;				   /**< One past the newest job */
+	Job jobs[JOBS_QUEUE_SIZE]; /**< The jobs, used as a ring */
+} JobQueue;
+
+/**
+ * Threads running jobs. Index 0 is the one calling jobs_run().
+ */
+static int n_threads = 1;
+/**
+ * Worker threads, from index 1
+ */
+static SDL_Thread *workers[JOBS_MAX_THREADS];
+/**
+ * Queue of every thread
+ */
+static JobQueue queues[JOBS_MAX_THREADS];
+/**
+ * Jobs in every queue, about to be queued included
+ */
+static SDL_AtomicInt queued;
+/**
+ * Workers sleeping, or about to
+ */
+static SDL_AtomicInt sleeping;
+/**
+ * Protects quitting, and lets sleeping workers wait on wake
+ */
+static SDL_Mutex *lock;
+/**
+ * Signalled when jobs are queued while workers sleep, or when they must quit
+ */
+static SDL_Condition *wake;
+/**
+ * Whether the workers must quit
+ */
+static bool quitting;
+
+/**
+ * Queues a job for the calling thread.
+ *
+ * @return True if it was queued, false if the queue is full
+ */
+static bool jobs_push(int self, const Job *job)
+{
+	JobQueue *queue = &queues[self];
+	bool pushed = false;
+
+	SDL_LockSpinlock(&queue->lock);
+	if (queue->bottom - queue->top < JOBS_QUEUE_SIZE) {
+		queue->jobs[queue->bottom % JOBS_QUEUE_SIZE] = *job;
+		queue->bottom++;
+		pushed = true;
+	}
+	SDL_UnlockSpinlock(&queue->lock);
+
+	return pushed;
+}
+
+/**
+ * Takes a job from one end of a queue.
+ *
+ * @param queue The queue
+ * @param newest Whether to take the newest job, as its owner does, or the oldest one
+ * @param job Where to put it
+ * @return True if there was one, false otherwise
+ */
+static bool jobs_take_from(JobQueue *queue, bool newest, Job *job)
+{
+	bool taken = false;
+
+	SDL_LockSpinlock(&queue->lock);
+	if (queue->top != queue->bottom) {
+		if (newest) {
+			*job = queue->jobs[--queue->bottom % JOBS_QUEUE_SIZE];
+		} else {
+			*job = queue->jobs[queue->top++ % JOBS_QUEUE_SIZE];
+		}
+		/* Rewound once empty, so they never overflow */
+		if (queue->top == queue->bottom) {
+			queue->top = queue->bottom = 0;
+		}
+		taken = true;
+	}
+	SDL_UnlockSpinlock(&queue->lock);
+
+	return taken;
+}
+
+/**
+ * Finds a job for a thread, in its own queue first and then in the others.
+ *
+ * @return True if one was found, false otherwise
+ */
+static bool jobs_take(int self, Job *job)
+{
+	if (SDL_GetAtomicInt(&queued) == 0) {
+		return false;
+	}
+	if (jobs_take_from(&queues[self], true, job)) {
+		SDL_AddAtomicInt(&queued, -1);
+		return true;
+	}
+	for (int i = 1; i < n_threads; i++) {
+		if (jobs_take_from(&queues[(self + i) % n_threads], false, job)) {
+			SDL_AddAtomicInt(&queued, -1);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void jobs_start_stage(int self, JobGraph *graph, JobStage *stage);
+static void jobs_execute(int self, const Job *job);
+
+/**
+ * Starts the stages that were waiting for one, and counts it as finished.
+ */
+static void jobs_finish_stage(int self, JobGraph *graph, JobStage *stage)
+{
+	Uint32 bit = JOB_AFTER(stage - graph->stages);
+
+	for (JobStage *next = stage + 1; next < graph->stages + graph->n_stages; next++) {
+		if ((next->depends & bit) && SDL_AddAtomicInt(&next->waiting, -1) == 1) {
+			jobs_start_stage(self, graph, next);
+		}
+	}
+	/* Last, jobs_run() may return and take the graph with it right after */
+	SDL_AddAtomicInt(&graph->unfinished, -1);
+}
+
+/**
+ * Splits a stage into jobs and queues them, waking up sleeping workers to steal them.
+ */
+static void jobs_start_stage(int self, JobGraph *graph, JobStage *stage)
+{
+	int n_jobs = (stage->count + stage->size - 1) / stage->size;
+
+	if (n_jobs == 0) {
+		jobs_finish_stage(self, graph, stage);
+		return;
+	}
+	SDL_SetAtomicInt(&stage->unfinished, n_jobs);
+	/* A single job isn't worth waking anyone up for */
+	if (n_jobs == 1 || n_threads == 1) {
+		for (int begin = 0; begin < stage->count; begin += stage->size) {
+			Job job = { graph, stage, begin, SDL_min(begin + stage->size, stage->count) };
+			jobs_execute(self, &job);
+		}
+		return;
+	}
+
+	/* Counted up front, so it never drops below what the queues hold */
+	SDL_AddAtomicInt(&queued, n_jobs);
+	/* Last ones first, so this thread runs them in order while thieves take the last ones */
+	for (int begin = (n_jobs - 1) * stage->size; begin >= 0; begin -= stage->size) {
+		Job job = { graph, stage, begin, SDL_min(begin + stage->size, stage->count) };
+		if (!jobs_push(self, &job)) {
+			SDL_AddAtomicInt(&queued, -1);
+			jobs_execute(self, &job);
+		}
+	}
+	/* A worker either sees the jobs before sleeping, or is asleep by the time the lock is free */
+	if (SDL_GetAtomicInt(&sleeping) > 0) {
+		SDL_LockMutex(lock);
+		SDL_BroadcastCondition(wake);
+		SDL_UnlockMutex(lock);
+	}
+}
+
+/**
+ * Runs a job, and finishes its stage if it was the last one.
+ */
+static void jobs_execute(int self, const Job *job)
+{
+	JobStage *stage = job->stage;
+
+	{
+		PROFILE_ZONE(stage->name);
+		stage->function(stage->data, job->begin, job->end);
+	}
+	if (SDL_AddAtomicInt(&stage->unfinished, -1) == 1) {
+		jobs_finish_stage(self, job->graph, stage);
+	}
+}
+
+/**
+ * Runs jobs as they come, and sleeps when there are none for a while.
+ */
+static int SDLCALL jobs_worker(void *data)
+{
+	int self = (int)(intptr_t)data;
+	Job job;
+	bool quit = false;
+
+	while (!quit) {
+		for (int spin = 0; spin < JOBS_SPIN; spin++) {
+			if (jobs_take(self, &job)) {
+				jobs_execute(self, &job);
+				spin = 0;
+			}
+			SDL_CPUPauseInstruction();
+		}
+
+		SDL_LockMutex(lock);
+		SDL_AddAtomicInt(&sleeping, 1);
+		while (!quitting && SDL_GetAtomicInt(&queued) == 0) {
+			SDL_WaitCondition(wake, lock);
+		}
+		SDL_AddAtomicInt(&sleeping, -1);
+		quit = quitting;
+		SDL_UnlockMutex(lock);
+	}
+
+	return 0;
+}
+
+bool jobs_init(int n_workers)
+{
+	n_workers = SDL_clamp(n_workers, 0, JOBS_MAX_THREADS - 1);
+	if (n_workers == 0) {
+		return true;
+	}
+
+	lock = SDL_CreateMutex();
+	wake = SDL_CreateCondition();
+	if (!lock || !wake) {
+		SDL_Log("Couldn't create job system lock: %s", SDL_GetError());
+		SDL_DestroyCondition(wake);
+		SDL_DestroyMutex(lock);
+		lock = NULL;
+		wake = NULL;
+		return false;
+	}
+	quitting = false;
+	int started = 1;
+	while (started <= n_workers) {
+		workers[started] = SDL_CreateThread(jobs_worker, "jobs", (void *)(intptr_t)started);
+		if (!workers[started]) {
+			SDL_Log("Couldn't create job thread: %s", SDL_GetError());
+			break;
+		}
+		started++;
+	}
+	/* Workers only look at it once jobs are queued, after this */
+	n_threads = started;
+
+	return n_threads == n_workers + 1;
+}
+
+void jobs_quit(void)
+{
+	if (!lock) {
+		return;
+	}
+
+	SDL_LockMutex(lock);
+	quitting = true;
+	SDL_BroadcastCondition(wake);
+	SDL_UnlockMutex(lock);
+	for (int i = 1; i < n_threads; i++) {
+		SDL_WaitThread(workers[i], NULL);
+		workers[i] = NULL;
+	}
+	n_threads = 1;
+
+	SDL_DestroyCondition(wake);
+	SDL_DestroyMutex(lock);
+	lock = NULL;
+	wake = NULL;
+}
+
+int jobs_threads(void)
+{
+	return n_threads;
+}
+
+void jobs_graph_init(JobGraph *graph)
+{
+	graph->n_stages = 0;
+}
+
+int jobs_stage(JobGraph *graph, const char *name, JobFunction function, void *data, int count,
+			   int size, Uint32 depends)
+{
+	SDL_assert(graph->n_stages < JOBS_MAX_STAGES);
+	/* Only on earlier stages, so there can't be cycles */
+	SDL_assert(depends < JOB_AFTER(graph->n_stages));
+	SDL_assert(size > 0);
+
+	JobStage *stage = &graph->stages[graph->n_stages];
+	stage->name = name;
+	stage->function = function;
+	stage->data = data;
+	stage->count = count;
+	stage->size = size;
+	stage->depends = depends;
+
+	return graph->n_stages++;
+}
+
+void jobs_run(JobGraph *graph)
+{
+	PROFILE_FUNCTION();
+	Job job;
+
+	/* Everything is counted before anything starts, stages finish as soon as they start */
+	SDL_SetAtomicInt(&graph->unfinished, graph->n_stages);
+	for (int i = 0; i < graph->n_stages; i++) {
+		SDL_SetAtomicInt(&graph->stages[i].waiting, __builtin_popcount(graph->stages[i].depends));
+	}
+	for (int i = 0; i < graph->n_stages; i++) {
+		if (graph->stages[i].depends == 0) {
+			jobs_start_stage(0, graph, &graph->stages[i]);
+		}
+	}
+
+	while (SDL_GetAtomicInt(&graph->unfinished) > 0) {
+		if (jobs_take(0, &job)) {
+			jobs_execute(0, &job);
+		} else {
+			SDL_CPUPauseInstruction();
+		}
+	}
+}
@@ -0,0 +1,124 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdbool.h>
+
+#include <SDL3/SDL_atomic.h>
+#include <SDL3/SDL_stdinc.h>
+
+/**
+ * A small work-stealing job system, running graphs of stages on a pool of worker threads.
+ *
+ * A stage is a function run over a range of items, split into jobs of a few items each. It
+ * starts once every stage it depends on has finished. Its jobs are queued by the thread that
+ * started it, which runs them newest first while idle threads steal the oldest ones.
+ *
+ * Which thread runs a job, and when, is up to timing. For the result not to be, jobs of a stage
+ * must only write what no other job of the same stage reads or writes.
+ *
+ * Without jobs_init(), or with no workers, every stage runs on the thread calling jobs_run().
+ */
+
+/**
+ * @brief Threads that can run jobs, the one calling jobs_run() included
+ */
+#define JOBS_MAX_THREADS 64
+/**
+ * @brief Stages of a graph
+ */
+#define JOBS_MAX_STAGES 16
+/**
+ * @brief Jobs queued by one thread at most. Past that, they run right away on that thread.
+ */
+#define JOBS_QUEUE_SIZE 1024
+/**
+ * @brief Times an idle worker looks for jobs before going to sleep
+ */
+#define JOBS_SPIN 4096
+
+/**
+ * @brief Dependency on a stage, for jobs_stage()
+ */
+#define JOB_AFTER(stage) ((Uint32)1 << (stage))
+
+/**
+ * Runs a stage on some of its items.
+ *
+ * @param data Data given to jobs_stage()
+ * @param begin First item
+ * @param end One past the last item
+ */
+typedef void (*JobFunction)(void *data, int begin, int end);
+
+/**
+ * A function to run over a range of items, once some other stages are done.
+ */
+typedef struct {
+	const char* name;		  /**< Name of the stage, a string literal, for the profiler */
+	JobFunction function;	  /**< What to run */
+	void* data;				  /**< Given to the function */
+	int count;				  /**< Number of items */
+	int size;				  /**< Items per job */
+	Uint32 depends;			  /**< JOB_AFTER() of every stage that must finish first */
+	SDL_AtomicInt unfinished; /**< Jobs that haven't finished yet, once it started */
+	SDL_AtomicInt waiting;	  /**< Stages it depends on that haven't finished yet */
+} JobStage;
+
+/**
+ * Stages to run, each one after the ones it depends on.
+ */
+typedef struct {
+	JobStage stages[JOBS_MAX_STAGES]; /**< The stages, in the order they were added */
+	int n_stages;					  /**< Number of stages */
+	SDL_AtomicInt unfinished;		  /**< Stages that haven't finished yet */
+} JobGraph;
+
+/**
+ * Starts the worker threads. Runs everything on the calling thread if they can't be started.
+ *
+ * @param workers Threads to start besides the one calling jobs_run(), up to JOBS_MAX_THREADS - 1
+ * @return True if every worker started, false otherwise
+ */
+bool jobs_init(int workers);
+
+/**
+ * Stops the worker threads. Must not be called while a graph runs.
+ */
+void jobs_quit(void);
+
+/**
+ * @return Threads running jobs, the one calling jobs_run() included
+ */
+int jobs_threads(void);
+
+/**
+ * Empties a graph, to add stages to it.
+ *
+ * @param graph The graph
+ */
+void jobs_graph_init(JobGraph *graph);
+
+/**
+ * Adds a stage to a graph.
+ *
+ * @param graph The graph
+ * @param name Name of the stage, a string literal
+ * @param function What to run
+ * @param data Given to the function
+ * @param count Number of items, the stage finishes right away if there are none
+ * @param size Items per job, the last one may have less
+ * @param depends JOB_AFTER() of every stage that must finish first, all of them added before
+ * @return Index of the stage, for JOB_AFTER()
+ */
+int jobs_stage(JobGraph *graph, const char *name, JobFunction function, void *data, int count,
+			   int size, Uint32 depends);
+
+/**
+ * Runs a graph, helping the workers with it, and returns once every stage has finished. Only one
+ * graph can run at a time.
+ *
+ * @param graph The graph
+ */
+void jobs_run(JobGraph *graph);
+
+#endif	// !JOBS_H
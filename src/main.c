@@ -14,22 +14,83 @@
 #include <SDL3/SDL_render.h>
 #include <SDL3/SDL_surface.h>
 #include <SDL3/SDL_video.h>
-#include <SDL3_ttf/SDL_ttf.h>
 
 #define SDL_MAIN_USE_CALLBACKS 1 /* No need for main() */
 #include <SDL3/SDL_main.h>
 
+#include "bot.h"
+#include "capture.h"
+#include "churn.h"
 #include "config.h"
+#include "font.h"
 #include "game.h"
+#include "governor.h"
+#include "jobs.h"
+#include "net.h"
+#include "profile.h"
+#include "soak.h"
+#include "stats.h"
+#include "telemetry.h"
 
 /**
- * Updates the vertices of the player.
+ * Updates the vertices of the player, in window coordinates.
  */
-void update_player_vertices(Game* game);
+void update_player_vertices(Game* game, const SDL_FRect* view);
 /**
  * Draws a circle using the midpoint circle algorithm.
  */
 void drawcircle(SDL_Renderer* renderer, int x0, int y0, int radius);
+/**
+ * Draws a circle as a regular polygon of COARSE_CIRCLE_SIDES sides. Cheaper than drawcircle.
+ */
+void drawpolygon(SDL_Renderer* renderer, float x0, float y0, float radius);
+/**
+ * Checks whether a circle touches the part of the world shown in the window.
+ */
+static inline bool in_view(const SDL_FRect* view, float x, float y, float radius)
+{
+	return x + radius >= view->x && x - radius <= view->x + view->w && y + radius >= view->y
+		   && y - radius <= view->y + view->h;
+}
+
+/**
+ * Finds the gameplay action bound to a key.
+ *
+ * @return True if the key is bound to one, false otherwise
+ */
+bool key_action(SDL_Keycode key, InputAction* action);
+/**
+ * Handles events when playing on a server. Keys are sent to it instead of applied.
+ */
+SDL_AppResult client_event(Game* game, SDL_Event* event);
+
+/**
+ * Makes SDL_AppIterate run only after events, or at full rate again. Does nothing if it already
+ * runs that way.
+ */
+void set_idle(bool on);
+/**
+ * Shows the frame, recording it first when capturing.
+ */
+void present(void);
+/**
+ * Waits for the rest of the frame, so that frames last at least frameDelay.
+ */
+void frame_cap(void);
+/**
+ * Runs the ticks of a turbo frame, with the bot playing, until the speed or the frame budget is
+ * reached. Stops turbo mode once a target is reached or the game is over.
+ */
+void turbo_update(Game* game);
+/**
+ * Stops turbo mode and hands the ship back to the player, logging why and how far it got.
+ */
+void turbo_stop(Game* game, const char* reason);
+
+/**
+ * Sides of the polygons that replace circles when quality is lowered
+ */
+#define COARSE_CIRCLE_SIDES 12
 
 /**
  * Indicates the ms that each frame has to last
@@ -44,6 +105,70 @@ Uint64 frame_start = 0;	 // ms at start of frame
  * delay.
  */
 int frame_time = 0;	 // ms elapsed this frame
+/**
+ * Indicates the ns at the start of the current frame, to measure its cost precisely
+ */
+Uint64 frame_start_ns = 0;
+
+/**
+ * @brief Whether SDL_AppIterate only runs after events
+ */
+static bool idle = false;
+
+/**
+ * @brief Whether the game is played on a server, see net.h
+ */
+static bool online = false;
+
+/**
+ * @brief Connection to the server, when online
+ */
+static NetClient client;
+
+/**
+ * @brief Recording of the frames shown, when its file is open
+ */
+static Capture capture;
+
+/**
+ * @brief Picks the quality tier that keeps frames within budget
+ */
+static Governor governor;
+
+/**
+ * @brief Whether the bot fast forwards the game, see --turbo
+ */
+static bool turbo = false;
+
+/**
+ * @brief Ticks per frame in turbo mode, 0 for as many as fit in a frame
+ */
+static int turbo_speed = TURBO_SPEED;
+
+/**
+ * @brief Level turbo mode stops at, 0 for none
+ */
+static unsigned int turbo_level = 0;
+
+/**
+ * @brief Tick turbo mode stops at, 0 for none
+ */
+static Uint64 turbo_tick = 0;
+
+/**
+ * @brief When turbo mode started, in ns
+ */
+static Uint64 turbo_start = 0;
+
+/**
+ * @brief Plays in turbo mode
+ */
+static Bot bot;
+
+/**
+ * @brief Statistics on the game, kept from their own thread with --stats
+ */
+static Stats stats;
 
 /**
  * @brief Window for the application
@@ -61,21 +186,9 @@ static SDL_Renderer* renderer;
 static SDL_AudioStream* stream = NULL;
 
 /**
- * All infomration needed to render the font
+ * @brief Color of the text
  */
-static struct {
-	enum {
-		NOTHING,
-		LEVEL,
-		LOAD_MENU,
-		LOAD_GAME_OVER
-	} state;			   /**< Indicates which render info is currently loaded */
-	TTF_Font* font;		   /**< Font to use */
-	SDL_Texture* texture1; /**< First loaded texture */
-	SDL_Texture* texture2; /**< Second loaded texture */
-	SDL_FRect rect1;	   /**< Rectangle to contain the first texture */
-	SDL_FRect rect2;	   /**< Rectangle to contain the second texture */
-} text_info = { NOTHING, NULL, NULL };
+static const SDL_FColor text_color = { 1.0f, 1.0f, 1.0f, 1.0f };
 
 /**
  * @brief Shows the start menu
@@ -102,6 +215,94 @@ SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[])
 {
 	SDL_AudioSpec spec;
 	Game* game;
+	SDL_FRect view;
+	bool soak = false;
+	Uint64 soak_ticks = SOAK_TICKS;
+	bool bench = false;
+	int bench_asteroids = BENCH_ASTEROIDS;
+	/* The thread calling SDL_AppIterate helps them */
+	int workers = SDL_GetNumLogicalCPUCores() - 1;
+	Uint64 seed = time(NULL);
+	bool server = false;
+	Uint16 port = NET_PORT;
+	NetConditions conditions = { 0 };
+	const char* capture_path = NULL;
+	bool keep_stats = false;
+	bool publish_telemetry = false;
+	int output_width, output_height;
+
+	/* Before SDL allocates anything */
+	churn_init();
+
+	for (int i = 1; i < argc; i++) {
+		if (SDL_strcmp(argv[i], "--soak") == 0) {
+			soak = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+				soak_ticks = SDL_strtoull(argv[++i], NULL, 10);
+		} else if (SDL_strcmp(argv[i], "--bench") == 0) {
+			bench = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+				bench_asteroids = SDL_atoi(argv[++i]);
+		} else if (SDL_strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+			workers = SDL_atoi(argv[++i]);
+		} else if (SDL_strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			seed = SDL_strtoull(argv[++i], NULL, 10);
+		} else if (SDL_strcmp(argv[i], "--server") == 0) {
+			server = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+				port = SDL_atoi(argv[++i]);
+		} else if (SDL_strcmp(argv[i], "--client") == 0) {
+			online = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+				port = SDL_atoi(argv[++i]);
+		} else if (SDL_strcmp(argv[i], "--loss") == 0 && i + 1 < argc) {
+			conditions.loss = SDL_atof(argv[++i]) / 100;
+		} else if (SDL_strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+			conditions.latency = SDL_atoi(argv[++i]);
+		} else if (SDL_strcmp(argv[i], "--jitter") == 0 && i + 1 < argc) {
+			conditions.jitter = SDL_atoi(argv[++i]);
+		} else if (SDL_strcmp(argv[i], "--telemetry") == 0) {
+			publish_telemetry = true;
+		} else if (SDL_strcmp(argv[i], "--stats") == 0) {
+			keep_stats = true;
+		} else if (SDL_strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+			capture_path = argv[++i];
+		} else if (SDL_strcmp(argv[i], "--turbo") == 0) {
+			turbo = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+				turbo_speed = SDL_atoi(argv[++i]);
+		} else if (SDL_strcmp(argv[i], "--until-level") == 0 && i + 1 < argc) {
+			turbo = true;
+			turbo_level = SDL_atoi(argv[++i]);
+		} else if (SDL_strcmp(argv[i], "--until-tick") == 0 && i + 1 < argc) {
+			turbo = true;
+			turbo_tick = SDL_strtoull(argv[++i], NULL, 10);
+		}
+	}
+
+	if (!jobs_init(workers)) {
+		SDL_Log("Couldn't start every job thread, running on %d", jobs_threads());
+	}
+	/* Soak runs and servers are the ones left running the longest, they publish too */
+	if (publish_telemetry && !telemetry_open()) {
+		return SDL_APP_FAILURE;
+	}
+
+	if (bench) {
+		*appstate = NULL;
+		return soak_bench(seed, bench_asteroids, BENCH_TICKS) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+	}
+	if (soak) {
+		/* Headless, no window nor renderer is needed */
+		*appstate = NULL;
+		return soak_run(seed, soak_ticks) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+	}
+	if (server) {
+		/* Headless too, it only simulates */
+		*appstate = NULL;
+		return net_server_run(port, &conditions) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+	}
+
 	if (!SDL_SetAppMetadata("Asteroids Clone", "0.1", "org.asteroids")) {
 		SDL_Log("Unable to set app metadata: %s\n", SDL_GetError());
 		return SDL_APP_FAILURE;
@@ -119,16 +320,20 @@ SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[])
 		SDL_Log("Unable to create renderer: %s\n", SDL_GetError());
 		return SDL_APP_FAILURE;
 	}
-
-	/* TTF */
-	if (!TTF_Init()) {
-		SDL_Log("Couldn't initialise SDL_ttf: %s\n", SDL_GetError());
-		return SDL_APP_FAILURE;
+	SDL_SetWindowMinimumSize(window, MIN_WIDTH, MIN_HEIGHT);
+
+	/* Capture, in pixels, which may be more than the window size */
+	if (capture_path) {
+		if (!SDL_GetCurrentRenderOutputSize(renderer, &output_width, &output_height)
+			|| !capture_start(&capture, capture_path, output_width, output_height)) {
+			SDL_Log("Couldn't start capture");
+			return SDL_APP_FAILURE;
+		}
 	}
 
-	text_info.font = TTF_OpenFont("./font/AzeretMono.ttf", 50);
-	if (!text_info.font) {
-		SDL_Log("Couldn't load font: %s\n", SDL_GetError());
+	/* Font */
+	if (!font_init(renderer)) {
+		SDL_Log("Couldn't load font");
 		return SDL_APP_FAILURE;
 	}
 
@@ -147,8 +352,29 @@ SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[])
 		SDL_Log("Couldn't initialize game");
 		return SDL_APP_FAILURE;
 	}
+	if (online && !net_client_open(&client, port, &conditions)) {
+		SDL_Log("Couldn't start the client");
+		return SDL_APP_FAILURE;
+	}
+	/* Online, the game is only drawn here and nothing happens in it */
+	if (keep_stats && !online && !stats_start(&stats, &game->events)) {
+		SDL_Log("Couldn't keep statistics");
+		return SDL_APP_FAILURE;
+	}
+	/* Straight into the game, the server plays it when online */
+	turbo = turbo && !online;
+	if (turbo) {
+		if (!bot_init(&bot, game)) {
+			SDL_Log("Couldn't start the bot");
+			return SDL_APP_FAILURE;
+		}
+		game->state = PLAY;
+		turbo_start = SDL_GetTicksNS();
+	}
 
-	update_player_vertices(game);
+	game_view(game, &view);
+	update_player_vertices(game, &view);
+	governor_init(&governor);
 	*appstate = game;
 
 	return SDL_APP_CONTINUE;
@@ -159,8 +385,10 @@ SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[])
  */
 SDL_AppResult SDL_AppEvent(void* appstate, SDL_Event* event)
 {
+	PROFILE_FUNCTION();
+	CHURN_SITE("events");
 	Game* game = appstate;
-	Player* player = game->player;
+	InputAction action;
 	if (event->type == SDL_EVENT_WINDOW_RESIZED) {
 		SDL_GetWindowSize(window, &game->width, &game->height);
 		SDL_SetRenderViewport(renderer, NULL);
@@ -171,6 +399,9 @@ SDL_AppResult SDL_AppEvent(void* appstate, SDL_Event* event)
 	if (event->type == SDL_EVENT_QUIT)
 		return SDL_APP_SUCCESS;
 
+	if (online)
+		return client_event(game, event);
+
 	if (event->type == SDL_EVENT_KEY_DOWN) {
 		if (game->state == MENU) {
 			if (event->key.key == SDLK_RETURN || event->key.key == SDLK_Q)
@@ -191,47 +422,70 @@ SDL_AppResult SDL_AppEvent(void* appstate, SDL_Event* event)
 			game->state = PLAY;
 			return SDL_APP_CONTINUE;
 		}
-		switch (event->key.key) {
-		case SDLK_LEFT:
-			player->direction_state = COUNTER_CLOCKWISE;
-			break;
-		case SDLK_RIGHT:
-			player->direction_state = CLOCKWISE;
-			break;
-		case SDLK_UP:
-			player->acceleration_state = ACCELERATING;
-			break;
-		case SDLK_DOWN:
-			player->acceleration_state = DECELERATING;
-			break;
-		case SDLK_SPACE:
-			game_shoot(game);
-			break;
-		case SDLK_P:
+		/* Gameplay keys are queued, and applied at the start of the next tick */
+		if (key_action(event->key.key, &action)) {
+			if (turbo)
+				turbo_stop(game, "taken over");
+			game_input(game, action, true, event->key.timestamp);
+		} else if (event->key.key == SDLK_P) {
 			game->state = PAUSE;
-			break;
-		case SDLK_RETURN:
-		case SDLK_Q:
+		} else if (event->key.key == SDLK_RETURN || event->key.key == SDLK_Q) {
 			return SDL_APP_SUCCESS;
-			break;
-		default:
-			break;
 		}
 	}
 
-	if (event->type == SDL_EVENT_KEY_UP) {
-		switch (event->key.key) {
-		case SDLK_LEFT:
-		case SDLK_RIGHT:
-			player->direction_state = STILL;
-			break;
-		case SDLK_UP:
-		case SDLK_DOWN:
-			player->acceleration_state = CONSTANT;
-			break;
-		default:
-			break;
-		}
+	/* Releasing fire does nothing, nor releasing keys while the bot plays */
+	if (event->type == SDL_EVENT_KEY_UP && !turbo && key_action(event->key.key, &action)
+		&& action != INPUT_FIRE)
+		game_input(game, action, false, event->key.timestamp);
+
+	return SDL_APP_CONTINUE;
+}
+
+bool key_action(SDL_Keycode key, InputAction* action)
+{
+	switch (key) {
+	case SDLK_LEFT:
+		*action = INPUT_LEFT;
+		return true;
+	case SDLK_RIGHT:
+		*action = INPUT_RIGHT;
+		return true;
+	case SDLK_UP:
+		*action = INPUT_THRUST;
+		return true;
+	case SDLK_DOWN:
+		*action = INPUT_BRAKE;
+		return true;
+	case SDLK_SPACE:
+		*action = INPUT_FIRE;
+		return true;
+	default:
+		return false;
+	}
+}
+
+SDL_AppResult client_event(Game* game, SDL_Event* event)
+{
+	InputAction action;
+
+	/* The server already knows the key is held */
+	if ((event->type != SDL_EVENT_KEY_DOWN && event->type != SDL_EVENT_KEY_UP)
+		|| event->key.repeat)
+		return SDL_APP_CONTINUE;
+
+	if (event->type == SDL_EVENT_KEY_DOWN) {
+		if (event->key.key == SDLK_RETURN || event->key.key == SDLK_Q)
+			return SDL_APP_SUCCESS;
+		/* The state is the one of the snapshot being drawn, the server has the last word */
+		if (game->state != PLAY)
+			net_client_input(&client, NET_COMMAND_START, true);
+		else if (key_action(event->key.key, &action))
+			net_client_input(&client, action, true);
+		else if (event->key.key == SDLK_P)
+			net_client_input(&client, NET_COMMAND_PAUSE, true);
+	} else if (key_action(event->key.key, &action) && action != INPUT_FIRE) {
+		net_client_input(&client, action, false);
 	}
 
 	return SDL_APP_CONTINUE;
@@ -242,28 +496,61 @@ SDL_AppResult SDL_AppEvent(void* appstate, SDL_Event* event)
  */
 SDL_AppResult SDL_AppIterate(void* appstate)
 {
+	PROFILE_FUNCTION();
+	CHURN_SITE("frame");
 	Game* game = appstate;
 	Player* player = game->player;
+	SDL_FRect view;
+
+	/*
+	 * Nothing moves outside of PLAY, so the screen only has to be redrawn when something happens.
+	 * Online, the server can change the state at any time. Recordings need every frame.
+	 */
+	set_idle(!online && !capture.file && game->state != PLAY);
 
 	SDL_SetRenderDrawColorFloat(renderer, BG_COLOR, 1.0f);
 	SDL_RenderClear(renderer);
 
 	frame_start = SDL_GetTicks();
+	frame_start_ns = SDL_GetTicksNS();
+
+	/* The server simulates, the client only draws what it sends */
+	if (online)
+		net_client_update(&client, game);
 
 	SDL_SetRenderDrawColorFloat(renderer, LINE_COLOR, 1.0f);
 	/* Menu */
 	if (game->state == MENU) {
 		showMenu(game);
-		SDL_RenderPresent(renderer);
+		present();
+		telemetry_frame(game, frame_start_ns);
+		frame_cap();
 		return SDL_APP_CONTINUE;
 	}
 
 	if (game->state == GAME_OVER) {
 		showGameOver(game);
-		SDL_RenderPresent(renderer);
+		present();
+		telemetry_frame(game, frame_start_ns);
+		frame_cap();
 		return SDL_APP_CONTINUE;
 	}
 
+	if (game->state == PLAY && !online) {
+		CHURN_SITE("update");
+		game->cheap_collisions = governor.tier >= QUALITY_COLLISIONS;
+		/* Event timestamps are on the SDL_GetTicksNS() clock */
+		game->time = SDL_GetTicksNS();
+		if (turbo)
+			turbo_update(game);
+		else
+			game_update_frame(game);
+	}
+
+	/* The window may have been resized even if the game is paused */
+	game_view(game, &view);
+	update_player_vertices(game, &view);
+
 	/* Pause menu */
 	if (game->state == PAUSE) {
 		/* Paint everything gray */
@@ -273,13 +560,12 @@ SDL_AppResult SDL_AppIterate(void* appstate)
 		}
 	}
 
-	if (game->state == PLAY) {
-		game_update_frame(game);
-		update_player_vertices(game);
-	}
-
 	showScoreboard(game);
 
+	/* Draw the edges of the world */
+	SDL_RenderRect(renderer,
+				   &(SDL_FRect){ -view.x, -view.y, game->world_width, game->world_height });
+
 	/* Draw player */
 	if (!SDL_RenderGeometry(renderer, NULL, player->vertices, 4, player->indices, 6)) {
 		SDL_Log("Couldn't render geometry: %s", SDL_GetError());
@@ -287,24 +573,47 @@ SDL_AppResult SDL_AppIterate(void* appstate)
 	}
 
 	/* Draw bullets */
-	for (int i = 0; i < game->n_bullets; i++) {
-		Bullet* bullet = &game->bullets[i];
-		drawcircle(renderer, bullet->x, bullet->y, BULLET_RADIUS);
+	{
+		PROFILE_ZONE("draw bullets");
+		CHURN_SITE("draw bullets");
+		Bullet* bullets = game->bullets.items;
+		for (int i = 0; i < game->bullets.count; i++) {
+			float x = REAL_FLOAT(bullets[i].x);
+			float y = REAL_FLOAT(bullets[i].y);
+			if (!in_view(&view, x, y, BULLET_RADIUS))
+				continue;
+			if (governor.tier >= QUALITY_CIRCLES)
+				drawpolygon(renderer, x - view.x, y - view.y, BULLET_RADIUS);
+			else
+				drawcircle(renderer, x - view.x, y - view.y, BULLET_RADIUS);
+		}
 	}
 
 	/* Draw asteroids */
-	for (int i = 0; i < game->n_asteroids; i++) {
-		Asteroid* asteroid = &game->asteroids[i];
-		drawcircle(renderer, asteroid->x, asteroid->y, asteroid->radius);
+	{
+		PROFILE_ZONE("draw asteroids");
+		CHURN_SITE("draw asteroids");
+		for (int i = 0; i < game->asteroids.count; i++) {
+			Asteroid asteroid = asteroid_get(game, i);
+			float x = REAL_FLOAT(asteroid.x);
+			float y = REAL_FLOAT(asteroid.y);
+			float radius = REAL_FLOAT(asteroid.radius);
+			if (!in_view(&view, x, y, radius))
+				continue;
+			if (governor.tier >= QUALITY_CIRCLES)
+				drawpolygon(renderer, x - view.x, y - view.y, radius);
+			else
+				drawcircle(renderer, x - view.x, y - view.y, radius);
+		}
 	}
 
-	SDL_RenderPresent(renderer);
+	present();
 
-	/* Frame cap */
-	frame_time = SDL_GetTicks() - frame_start;
-	if (frame_time < frameDelay) {
-		SDL_Delay(frameDelay - frame_time);
-	}
+	/* Turbo frames are as long as they can be on purpose */
+	if (!turbo)
+		governor_update(&governor, SDL_GetTicksNS() - frame_start_ns);
+	telemetry_frame(game, frame_start_ns);
+	frame_cap();
 
 	return SDL_APP_CONTINUE;
 }
@@ -315,17 +624,98 @@ SDL_AppResult SDL_AppIterate(void* appstate)
 void SDL_AppQuit(void* appstate, SDL_AppResult result)
 {
 	Game* game = appstate;
+	stats_stop(&stats);
+	telemetry_close();
 	if (game)
 		game_free(game);
-	TTF_Quit();
+	if (online)
+		net_client_close(&client);
+	bot_free(&bot);
+	capture_stop(&capture);
+	jobs_quit();
+	profile_dump(PROFILE_OUTPUT);
+	font_quit();
+	churn_dump();
 	SDL_DestroyRenderer(renderer);
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 }
 
-void update_player_vertices(Game* game)
+void set_idle(bool on)
+{
+	if (on == idle)
+		return;
+
+	/*
+	 * Where the hint is ignored, idle screens still run at FPS because of the frame cap. Going
+	 * back to full rate takes effect on the next iteration, which the event that left the idle
+	 * screen already triggers.
+	 */
+	if (!SDL_SetHint(SDL_HINT_MAIN_CALLBACK_RATE, on ? "waitevent" : "0")) {
+		SDL_Log("Couldn't change the iteration rate: %s", SDL_GetError());
+		return;
+	}
+	idle = on;
+}
+
+void present(void)
+{
+	CHURN_SITE("present");
+	if (capture.file)
+		capture_frame(&capture, renderer);
+
+	{
+		PROFILE_ZONE("SDL_RenderPresent");
+		SDL_RenderPresent(renderer);
+	}
+	churn_frame();
+}
+
+void frame_cap(void)
+{
+	frame_time = SDL_GetTicks() - frame_start;
+	if (frame_time < frameDelay) {
+		PROFILE_ZONE("frame cap");
+		SDL_Delay(frameDelay - frame_time);
+	}
+}
+
+void turbo_update(Game* game)
+{
+	PROFILE_FUNCTION();
+	Uint64 deadline = frame_start_ns + (Uint64)(TURBO_BUDGET * SDL_NS_PER_SECOND / FPS);
+
+	/* Only the last tick of the frame is drawn */
+	for (int i = 0; turbo_speed > 0 ? i < turbo_speed : SDL_GetTicksNS() < deadline; i++) {
+		bot_play(&bot, game);
+		game_update_frame(game);
+		if (game->state == GAME_OVER) {
+			turbo_stop(game, "game over");
+			return;
+		}
+		/* Paused there, for the player to take over */
+		if ((turbo_level > 0 && game->level >= turbo_level)
+			|| (turbo_tick > 0 && game->tick >= turbo_tick)) {
+			turbo_stop(game, "target reached");
+			game->state = PAUSE;
+			return;
+		}
+	}
+}
+
+void turbo_stop(Game* game, const char* reason)
+{
+	SDL_Log("turbo: %s, level %u at tick %llu after %.1f s", reason, game->level,
+			(unsigned long long)game->tick, (SDL_GetTicksNS() - turbo_start) / 1e9);
+	bot_stop(&bot, game);
+	turbo = false;
+}
+
+void update_player_vertices(Game* game, const SDL_FRect* view)
 {
 	Player* player = game->player;
+	float x = REAL_FLOAT(player->x) - view->x;
+	float y = REAL_FLOAT(player->y) - view->y;
 	/*
 	 * Imagine the shape as an inscribed isosceles triangle in a circle. The direction is the angle
 	 * between the vertical and the radius that goes through the acutest corner (aft)
@@ -341,24 +731,24 @@ void update_player_vertices(Game* game)
 #define sin_135 0.7071067
 #define cos_135 -0.7071067
 
-	player->vertices[AFT].position.x = player->x;
-	player->vertices[AFT].position.y = player->y;
+	player->vertices[AFT].position.x = x;
+	player->vertices[AFT].position.y = y;
 	player->vertices[AFT].color = (SDL_FColor){ 255, 255, 255, 255 };
 
-	player->vertices[BOW].position.x = player->x + sin_dir * SHIP_RADIUS;
-	player->vertices[BOW].position.y = player->y - cos_dir * SHIP_RADIUS;
+	player->vertices[BOW].position.x = x + sin_dir * SHIP_RADIUS;
+	player->vertices[BOW].position.y = y - cos_dir * SHIP_RADIUS;
 	player->vertices[BOW].color = (SDL_FColor){ 255, 255, 255, 255 };
 
 	player->vertices[PORT].position.x
-	  = player->x + (sin_dir * cos_135 - cos_dir * sin_135) * SHIP_RADIUS;
+	  = x + (sin_dir * cos_135 - cos_dir * sin_135) * SHIP_RADIUS;
 	player->vertices[PORT].position.y
-	  = player->y - (cos_dir * cos_135 + sin_dir * sin_135) * SHIP_RADIUS;
+	  = y - (cos_dir * cos_135 + sin_dir * sin_135) * SHIP_RADIUS;
 	player->vertices[PORT].color = (SDL_FColor){ 255, 255, 255, 255 };
 
 	player->vertices[STARBOARD].position.x
-	  = player->x + (sin_dir * cos_135 + cos_dir * sin_135) * SHIP_RADIUS;
+	  = x + (sin_dir * cos_135 + cos_dir * sin_135) * SHIP_RADIUS;
 	player->vertices[STARBOARD].position.y
-	  = player->y - (cos_dir * cos_135 - sin_dir * sin_135) * SHIP_RADIUS;
+	  = y - (cos_dir * cos_135 - sin_dir * sin_135) * SHIP_RADIUS;
 	player->vertices[STARBOARD].color = (SDL_FColor){ 255, 255, 255, 255 };
 }
 
@@ -397,55 +787,39 @@ void drawcircle(SDL_Renderer* renderer, int x0, int y0, int radius)
 	}
 }
 
-/**
- *
- */
-void showMenu(Game* game)
+void drawpolygon(SDL_Renderer* renderer, float x0, float y0, float radius)
 {
-	if (!game)
-		return;
+	static SDL_FPoint unit[COARSE_CIRCLE_SIDES + 1];
+	SDL_FPoint points[COARSE_CIRCLE_SIDES + 1];
 
-	if (text_info.texture1 && text_info.state == LOAD_MENU) {
-		SDL_RenderTexture(renderer, text_info.texture1, NULL, &text_info.rect1);
-		SDL_RenderTexture(renderer, text_info.texture2, NULL, &text_info.rect2);
-		return;
+	if (unit[0].x == 0) {
+		for (int i = 0; i <= COARSE_CIRCLE_SIDES; i++) {
+			unit[i].x = SDL_cosf(2 * SDL_PI_F * i / COARSE_CIRCLE_SIDES);
+			unit[i].y = SDL_sinf(2 * SDL_PI_F * i / COARSE_CIRCLE_SIDES);
+		}
 	}
 
-	if (text_info.texture1) {
-		SDL_DestroyTexture(text_info.texture1);
-		SDL_DestroyTexture(text_info.texture2);
-		text_info.texture1 = NULL;
-		text_info.texture2 = NULL;
+	for (int i = 0; i <= COARSE_CIRCLE_SIDES; i++) {
+		points[i].x = x0 + unit[i].x * radius;
+		points[i].y = y0 + unit[i].y * radius;
 	}
+	SDL_RenderLines(renderer, points, COARSE_CIRCLE_SIDES + 1);
+}
 
-	text_info.state = LOAD_MENU;
-
-	SDL_Surface* text
-	  = TTF_RenderText_Solid(text_info.font, "Asteroids", 9, (SDL_Color){ 255, 255, 255, 255 });
-	if (!text)
-		return;
-
-	text_info.texture1 = SDL_CreateTextureFromSurface(renderer, text);
-	text_info.rect1.x = ((float)game->width - text->w) / 2;
-	text_info.rect1.y = (float)game->height / 3;
-	text_info.rect1.w = text->w;
-	text_info.rect1.h = text->h;
-	SDL_DestroySurface(text);
-
-	text = TTF_RenderText_Solid(text_info.font, "Click any key to start", 23,
-								(SDL_Color){ 255, 255, 255, 255 });
-	if (!text)
+/**
+ *
+ */
+void showMenu(Game* game)
+{
+	CHURN_SITE("menu");
+	if (!game)
 		return;
 
-	text_info.texture2 = SDL_CreateTextureFromSurface(renderer, text);
-	text_info.rect2.x = ((float)game->width - (float)text->w / 2) / 2;
-	text_info.rect2.y = (float)game->height / 2;
-	text_info.rect2.w = (float)text->w / 2;
-	text_info.rect2.h = (float)text->h / 2;
-	SDL_DestroySurface(text);
-
-	SDL_RenderTexture(renderer, text_info.texture1, NULL, &text_info.rect1);
-	SDL_RenderTexture(renderer, text_info.texture2, NULL, &text_info.rect2);
+	font_draw(renderer, "Asteroids", ((float)game->width - font_width("Asteroids", 1)) / 2,
+			  (float)game->height / 3, 1, text_color);
+	font_draw(renderer, "Click any key to start",
+			  ((float)game->width - font_width("Click any key to start", 0.5f)) / 2,
+			  (float)game->height / 2, 0.5f, text_color);
 }
 
 /**
@@ -453,84 +827,30 @@ void showMenu(Game* game)
  */
 void showGameOver(Game* game)
 {
+	CHURN_SITE("game over");
 	if (!game)
 		return;
 
-	if (text_info.texture1 && text_info.state == LOAD_GAME_OVER) {
-		SDL_RenderTexture(renderer, text_info.texture1, NULL, &text_info.rect1);
-		SDL_RenderTexture(renderer, text_info.texture2, NULL, &text_info.rect2);
-		return;
-	}
-
-	if (text_info.texture1) {
-		SDL_DestroyTexture(text_info.texture1);
-		SDL_DestroyTexture(text_info.texture2);
-		text_info.texture1 = NULL;
-		text_info.texture2 = NULL;
-	}
-
-	text_info.state = LOAD_GAME_OVER;
-
-	SDL_Surface* text
-	  = TTF_RenderText_Solid(text_info.font, "Game Over", 9, (SDL_Color){ 255, 255, 255, 255 });
-	if (!text)
-		return;
-
-	text_info.texture1 = SDL_CreateTextureFromSurface(renderer, text);
-	text_info.rect1.x = ((float)game->width - text->w) / 2;
-	text_info.rect1.y = (float)game->height / 3;
-	text_info.rect1.w = text->w;
-	text_info.rect1.h = text->h;
-	SDL_DestroySurface(text);
-
-	text = TTF_RenderText_Solid(text_info.font, "Click any key to restart", 25,
-								(SDL_Color){ 255, 255, 255, 255 });
-	if (!text)
-		return;
-
-	text_info.texture2 = SDL_CreateTextureFromSurface(renderer, text);
-	text_info.rect2.x = ((float)game->width - (float)text->w / 2) / 2;
-	text_info.rect2.y = (float)game->height / 2;
-	text_info.rect2.w = text->w >> 1;
-	text_info.rect2.h = text->h >> 1;
-	SDL_DestroySurface(text);
-
-	SDL_RenderTexture(renderer, text_info.texture1, NULL, &text_info.rect1);
-	SDL_RenderTexture(renderer, text_info.texture2, NULL, &text_info.rect2);
+	font_draw(renderer, "Game Over", ((float)game->width - font_width("Game Over", 1)) / 2,
+			  (float)game->height / 3, 1, text_color);
+	font_draw(renderer, "Click any key to restart",
+			  ((float)game->width - font_width("Click any key to restart", 0.5f)) / 2,
+			  (float)game->height / 2, 0.5f, text_color);
 }
 
 void showScoreboard(Game* game)
 {
-	char level[11];
-	SDL_Color color;
+	PROFILE_FUNCTION();
+	CHURN_SITE("scoreboard");
+	char level[32];
+	SDL_FColor color;
 
 	if (!game)
 		return;
 
-	if (text_info.texture1 && text_info.state == LEVEL) {
-		SDL_DestroyTexture(text_info.texture1);
-		SDL_DestroyTexture(text_info.texture2);
-		text_info.texture1 = NULL;
-		text_info.texture2 = NULL;
-	}
-
-	text_info.state = LEVEL;
-
-	sprintf(level, "Level: %d", game->level);
-
-	color = (game->state == PAUSE) ? (SDL_Color){ 177, 177, 177, 255 }
-								   : (SDL_Color){ 255, 255, 255, 255 };
-	SDL_Surface* text = TTF_RenderText_Solid(text_info.font, level, strlen(level), color);
-
-	if (!text)
-		return;
-
-	text_info.texture1 = SDL_CreateTextureFromSurface(renderer, text);
-	text_info.rect1.x = 10;
-	text_info.rect1.y = 10;
-	text_info.rect1.w = text->w >> 2;
-	text_info.rect1.h = text->h >> 2;
-	SDL_DestroySurface(text);
+	SDL_snprintf(level, sizeof(level), "Level: %u", game->level);
 
-	SDL_RenderTexture(renderer, text_info.texture1, NULL, &text_info.rect1);
+	color = (game->state == PAUSE) ? (SDL_FColor){ 177 / 255.0f, 177 / 255.0f, 177 / 255.0f, 1.0f }
+								   : text_color;
+	font_draw(renderer, level, 10, 10, 0.25f, color);
 }
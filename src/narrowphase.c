@@ -0,0 +1,181 @@
+#include "narrowphase.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL3/SDL_log.h>
+
+/**
+ * @brief Alignment of the arrays, so a whole step can be loaded at once
+ */
+#define NARROWPHASE_ALIGN (NARROWPHASE_LANES * sizeof(Real))
+
+#ifdef FIXED_POINT
+/**
+ * @brief Padding position, far enough that nothing touches it, close enough not to overflow
+ */
+#define NARROWPHASE_FAR (-(1 << 30))
+#else
+#define NARROWPHASE_FAR INFINITY
+#endif
+
+#ifndef NARROWPHASE_SCALAR
+/**
+ * NARROWPHASE_LANES Reals, operated on all at once
+ */
+typedef Real Lanes __attribute__((vector_size(NARROWPHASE_LANES * sizeof(Real))));
+#ifdef FIXED_POINT
+/**
+ * The squares of some Lanes, wide enough not to overflow, to look at their signs
+ */
+typedef Sint64 LaneBits __attribute__((vector_size(NARROWPHASE_LANES * sizeof(Sint64))));
+#else
+/**
+ * The bits of some Lanes, to look at their signs
+ */
+typedef Sint32 LaneBits __attribute__((vector_size(NARROWPHASE_LANES * sizeof(Sint32))));
+#endif
+/**
+ * @brief Sign bits of the LaneBits in a 64 bits word
+ */
+#define LANE_SIGNS ((Uint64)1 << 63 | (Uint64)1 << (8 * sizeof(LaneBits) / NARROWPHASE_LANES - 1))
+#endif
+
+bool narrowphase_init(Narrowphase *narrowphase, int capacity)
+{
+	SDL_zerop(narrowphase);
+	capacity = (capacity + NARROWPHASE_LANES - 1) / NARROWPHASE_LANES * NARROWPHASE_LANES;
+	narrowphase->capacity = capacity;
+	narrowphase->x = aligned_alloc(NARROWPHASE_ALIGN, capacity * sizeof(Real));
+	narrowphase->y = aligned_alloc(NARROWPHASE_ALIGN, capacity * sizeof(Real));
+	narrowphase->radius = aligned_alloc(NARROWPHASE_ALIGN, capacity * sizeof(Real));
+	narrowphase->asteroids = malloc(capacity * sizeof(int));
+	narrowphase->hits = calloc(capacity * NARROWPHASE_BULLET_WORDS, sizeof(Uint64));
+	narrowphase->hit = calloc(capacity / 64 + 1, sizeof(Uint64));
+	if (!narrowphase->x || !narrowphase->y || !narrowphase->radius || !narrowphase->asteroids
+		|| !narrowphase->hits || !narrowphase->hit) {
+		SDL_Log("Couldn't allocate memory: %s", SDL_GetError());
+		narrowphase_free(narrowphase);
+		return false;
+	}
+	return true;
+}
+
+void narrowphase_free(Narrowphase *narrowphase)
+{
+	free(narrowphase->x);
+	free(narrowphase->y);
+	free(narrowphase->radius);
+	free(narrowphase->asteroids);
+	free(narrowphase->hits);
+	free(narrowphase->hit);
+	SDL_zerop(narrowphase);
+}
+
+void narrowphase_begin(Narrowphase *narrowphase)
+{
+	/* Only the candidates hit last frame have bullets to forget */
+	for (int word = 0; word <= narrowphase->count / 64; word++) {
+		for (Uint64 bits = narrowphase->hit[word]; bits; bits &= bits - 1) {
+			int candidate = word * 64 + __builtin_ctzll(bits);
+			SDL_memset(&narrowphase->hits[candidate * NARROWPHASE_BULLET_WORDS], 0,
+					   NARROWPHASE_BULLET_WORDS * sizeof(Uint64));
+		}
+		narrowphase->hit[word] = 0;
+	}
+	narrowphase->count = 0;
+}
+
+void narrowphase_end(Narrowphase *narrowphase)
+{
+	/* Far away, so no distance is ever small enough */
+	for (int i = narrowphase->count; i % NARROWPHASE_LANES; i++) {
+		narrowphase->x[i] = NARROWPHASE_FAR;
+		narrowphase->y[i] = NARROWPHASE_FAR;
+		narrowphase->radius[i] = 0;
+	}
+}
+
+/**
+ * Tests a circle against NARROWPHASE_LANES asteroids.
+ *
+ * The arithmetic and its order are the same in both builds, so that they give the same results
+ * bit for bit.
+ *
+ * @return Bitmask of the candidates it touches, bit 0 is the candidate at first
+ */
+static inline unsigned lanes_hit(const Narrowphase *narrowphase, int first, Real x, Real y,
+								 Real radius)
+{
+	unsigned mask = 0;
+
+#ifdef NARROWPHASE_SCALAR
+	for (int lane = 0; lane < NARROWPHASE_LANES; lane++) {
+		Real dx = x - narrowphase->x[first + lane];
+		Real dy = y - narrowphase->y[first + lane];
+		RealWide dist_sq = (RealWide)dx * dx + (RealWide)dy * dy;
+		Real radius_sum = narrowphase->radius[first + lane] + radius;
+		if (dist_sq <= (RealWide)radius_sum * radius_sum) {
+			mask |= 1u << lane;
+		}
+	}
+#else
+	Lanes dx = x - *(const Lanes *)&narrowphase->x[first];
+	Lanes dy = y - *(const Lanes *)&narrowphase->y[first];
+	Lanes radius_sum = *(const Lanes *)&narrowphase->radius[first] + radius;
+	/*
+	 * dist_sq <= radius_sum * radius_sum, as the sign of the difference, which is exact. Vector
+	 * comparisons wider than the hardware are split lane by lane, subtractions aren't.
+	 */
+#ifdef FIXED_POINT
+	LaneBits wide_dx = __builtin_convertvector(dx, LaneBits);
+	LaneBits wide_dy = __builtin_convertvector(dy, LaneBits);
+	LaneBits wide_sum = __builtin_convertvector(radius_sum, LaneBits);
+	LaneBits hit = ~(wide_sum * wide_sum - (wide_dx * wide_dx + wide_dy * wide_dy));
+#else
+	Lanes dist_sq = dx * dx + dy * dy;
+	LaneBits hit = ~(LaneBits)(radius_sum * radius_sum - dist_sq);
+#endif
+	Uint64 words[sizeof(LaneBits) / sizeof(Uint64)];
+	Uint64 signs = 0;
+
+	/* Most steps hit nothing, so that is found out without looking at every lane */
+	memcpy(words, &hit, sizeof(hit));
+	for (int word = 0; word < (int)SDL_arraysize(words); word++) {
+		signs |= words[word];
+	}
+	if (!(signs & LANE_SIGNS)) {
+		return 0;
+	}
+	for (int lane = 0; lane < NARROWPHASE_LANES; lane++) {
+		mask |= (unsigned)(hit[lane] < 0) << lane;
+	}
+#endif
+
+	return mask;
+}
+
+int narrowphase_first_hit(const Narrowphase *narrowphase, Real x, Real y, Real radius)
+{
+	for (int first = 0; first < narrowphase->count; first += NARROWPHASE_LANES) {
+		unsigned mask = lanes_hit(narrowphase, first, x, y, radius);
+		if (mask) {
+			return first + __builtin_ctz(mask);
+		}
+	}
+	return -1;
+}
+
+void narrowphase_test(Narrowphase *narrowphase, int bullet, Real x, Real y, Real radius)
+{
+	for (int first = 0; first < narrowphase->count; first += NARROWPHASE_LANES) {
+		/* Hits are rare, so they are recorded one by one */
+		for (unsigned mask = lanes_hit(narrowphase, first, x, y, radius); mask; mask &= mask - 1) {
+			int candidate = first + __builtin_ctz(mask);
+			narrowphase->hits[candidate * NARROWPHASE_BULLET_WORDS + bullet / 64]
+			  |= (Uint64)1 << (bullet % 64);
+			narrowphase->hit[candidate / 64] |= (Uint64)1 << (candidate % 64);
+		}
+	}
+}
@@ -0,0 +1,116 @@
+#ifndef NARROWPHASE_H
+#define NARROWPHASE_H
+
+#include <stdbool.h>
+
+#include <SDL3/SDL_stdinc.h>
+
+#include "config.h"
+#include "real.h"
+
+/**
+ * Circle hit tests of many asteroids against one circle at a time, NARROWPHASE_LANES asteroids
+ * per step. The asteroids that can be hit are copied into a structure of arrays first, and hits
+ * are recorded as bitmasks that the caller resolves in whatever order it needs.
+ *
+ * Built with -DNARROWPHASE_SCALAR the same tests run one asteroid at a time, to check that both
+ * give the same results. Built with -DFIXED_POINT the lanes are integers, and distances are
+ * squared in 64 bits.
+ */
+
+/**
+ * @brief Asteroids tested per step
+ */
+#define NARROWPHASE_LANES 8
+/**
+ * @brief Words of a bullet bitmask
+ */
+#define NARROWPHASE_BULLET_WORDS ((MAX_BULLETS + 63) / 64)
+
+/**
+ * Scratch space for the hit tests. Rebuilt every frame.
+ */
+typedef struct {
+	Real* x;		/**< X position of every candidate, padded to a whole step */
+	Real* y;		/**< Y position of every candidate */
+	Real* radius;	/**< Radius of every candidate */
+	int* asteroids; /**< Index of the asteroid of every candidate */
+	Uint64* hits;	/**< Bullets that hit every candidate, NARROWPHASE_BULLET_WORDS words each */
+	Uint64* hit;	/**< Candidates hit by any bullet, one bit each */
+	int capacity;	/**< Candidates that fit, a multiple of NARROWPHASE_LANES */
+	int count;		/**< Candidates loaded */
+} Narrowphase;
+
+/**
+ * Allocates the scratch space.
+ *
+ * @param narrowphase The scratch space to initialize
+ * @param capacity Maximum number of asteroids
+ * @return True if it was allocated, false otherwise
+ */
+bool narrowphase_init(Narrowphase *narrowphase, int capacity);
+
+/**
+ * Frees the scratch space.
+ *
+ * @param narrowphase The scratch space to free
+ */
+void narrowphase_free(Narrowphase *narrowphase);
+
+/**
+ * Forgets the candidates and hits of the last frame.
+ *
+ * @param narrowphase The scratch space
+ */
+void narrowphase_begin(Narrowphase *narrowphase);
+
+/**
+ * Adds an asteroid that can be hit. Candidates must be added in the order hits will be resolved.
+ *
+ * @param narrowphase The scratch space
+ * @param asteroid Index of the asteroid
+ * @param x X position of the asteroid
+ * @param y Y position of the asteroid
+ * @param radius Radius of the asteroid
+ */
+static inline void narrowphase_add(Narrowphase *narrowphase, int asteroid, Real x, Real y,
+								   Real radius)
+{
+	int candidate = narrowphase->count++;
+
+	narrowphase->x[candidate] = x;
+	narrowphase->y[candidate] = y;
+	narrowphase->radius[candidate] = radius;
+	narrowphase->asteroids[candidate] = asteroid;
+}
+
+/**
+ * Pads the candidates to a whole step. Must be called after adding the last one.
+ *
+ * @param narrowphase The scratch space
+ */
+void narrowphase_end(Narrowphase *narrowphase);
+
+/**
+ * Finds the first candidate a circle touches.
+ *
+ * @param narrowphase The scratch space
+ * @param x X position of the circle
+ * @param y Y position of the circle
+ * @param radius Radius of the circle
+ * @return First candidate touching the circle, -1 if none does
+ */
+int narrowphase_first_hit(const Narrowphase *narrowphase, Real x, Real y, Real radius);
+
+/**
+ * Tests a bullet against every candidate, and records which ones it hits.
+ *
+ * @param narrowphase The scratch space
+ * @param bullet Index of the bullet, below MAX_BULLETS
+ * @param x X position of the bullet
+ * @param y Y position of the bullet
+ * @param radius Radius of the bullet
+ */
+void narrowphase_test(Narrowphase *narrowphase, int bullet, Real x, Real y, Real radius);
+
+#endif	// !NARROWPHASE_H
@@ -0,0 +1,654 @@
+#include "net.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <SDL3/SDL_events.h>
+#include <SDL3/SDL_init.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_timer.h>
+
+#include "telemetry.h"
+
+/**
+ * @brief First byte of a packet from the client: acknowledgement, window size and inputs
+ */
+#define NET_PACKET_INPUT 1
+/**
+ * @brief First byte of a packet from the server: a snapshot
+ */
+#define NET_PACKET_SNAPSHOT 2
+/**
+ * @brief Fraction of its distance to the target that playback catches up every frame
+ */
+#define NET_CATCH_UP 0.1
+
+/**
+ * The server end, and what it knows of its only client.
+ */
+typedef struct {
+	NetLink link;			   /**< Socket clients send to */
+	Game* game;				   /**< The simulation */
+	Snapshot* history;		   /**< Snapshots sent, by tick modulo NET_HISTORY */
+	Uint32 tick;			   /**< Ticks run, whatever the state of the game */
+	bool connected;			   /**< Whether there is a client */
+	struct sockaddr_in client; /**< Address of the client */
+	Uint64 heard;			   /**< When the client was last heard from, in ns */
+	Uint32 acked;			   /**< Newest snapshot the client has, 0 if none */
+	Uint32 inputs;			   /**< Number of the next input of the client */
+	Uint64 bytes;			   /**< Bytes of the snapshots sent since the last report */
+	int max_bytes;			   /**< Biggest snapshot sent since the last report */
+	int sent;				   /**< Snapshots sent since the last report */
+	int full;				   /**< Snapshots sent without a baseline since the last report */
+	Uint64 serialize_ns;	   /**< Time spent capturing and encoding since the last report */
+	Uint64 serialize_max_ns;   /**< Longest capture and encode since the last report */
+} NetServer;
+
+/**
+ * @brief Snapshot to encode against when the other end has none. Tick 0, nothing in it.
+ */
+static const Snapshot empty;
+
+/**
+ * Nanoseconds since a performance counter value.
+ */
+static Uint64 elapsed_ns(Uint64 start)
+{
+	return (SDL_GetPerformanceCounter() - start) * SDL_NS_PER_SECOND
+		   / SDL_GetPerformanceFrequency();
+}
+
+/**
+ * Address of a port on the loopback interface.
+ */
+static struct sockaddr_in loopback(Uint16 port)
+{
+	struct sockaddr_in address;
+
+	SDL_zero(address);
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	return address;
+}
+
+/**
+ * Opens a non blocking UDP socket on the loopback interface.
+ *
+ * @param link The link to open
+ * @param port Port to bind to, 0 for any
+ * @param conditions How bad the simulated network is
+ * @return True if it was opened, false otherwise
+ */
+static bool link_open(NetLink *link, Uint16 port, const NetConditions *conditions)
+{
+	struct sockaddr_in address = loopback(port);
+
+	SDL_zerop(link);
+	link->conditions = *conditions;
+	link->rng = SDL_GetPerformanceCounter();
+	link->delayed = calloc(NET_DELAYED_PACKETS, sizeof(NetDelayed));
+	if (!link->delayed) {
+		SDL_Log("Couldn't allocate memory: %s", SDL_GetError());
+		return false;
+	}
+
+	link->socket = socket(AF_INET, SOCK_DGRAM, 0);
+	if (link->socket < 0) {
+		SDL_Log("Couldn't create socket: %s", strerror(errno));
+		free(link->delayed);
+		return false;
+	}
+	if (bind(link->socket, (struct sockaddr *)&address, sizeof(address)) < 0
+		|| fcntl(link->socket, F_SETFL, O_NONBLOCK) < 0) {
+		SDL_Log("Couldn't bind to port %u: %s", port, strerror(errno));
+		close(link->socket);
+		free(link->delayed);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Closes a link. Packets still held back are lost.
+ */
+static void link_close(NetLink *link)
+{
+	close(link->socket);
+	free(link->delayed);
+	link->delayed = NULL;
+}
+
+/**
+ * Sends a packet through the simulated network. Errors are ignored, UDP may lose it anyway.
+ */
+static void link_send(NetLink *link, const struct sockaddr_in *to, const Uint8 *data, int size)
+{
+	NetConditions *conditions = &link->conditions;
+	Uint64 delay;
+
+	link->sent_packets++;
+	link->sent_bytes += size;
+	if (conditions->loss > 0 && SDL_randf_r(&link->rng) < conditions->loss) {
+		link->dropped_packets++;
+		return;
+	}
+
+	delay = conditions->latency;
+	if (conditions->jitter > 0) {
+		delay += SDL_rand_r(&link->rng, conditions->jitter + 1);
+	}
+	if (delay == 0) {
+		sendto(link->socket, data, size, 0, (const struct sockaddr *)to, sizeof(*to));
+		return;
+	}
+
+	if (link->n_delayed == NET_DELAYED_PACKETS) {
+		link->dropped_packets++;
+		return;
+	}
+	/* Free slots have no size */
+	for (int i = 0; i < NET_DELAYED_PACKETS; i++) {
+		NetDelayed *packet = &link->delayed[i];
+		if (packet->size == 0) {
+			packet->due = SDL_GetTicksNS() + delay * SDL_NS_PER_MS;
+			packet->to = *to;
+			packet->size = size;
+			SDL_memcpy(packet->data, data, size);
+			link->n_delayed++;
+			break;
+		}
+	}
+}
+
+/**
+ * Sends the held back packets that are due, earliest first.
+ */
+static void link_pump(NetLink *link)
+{
+	Uint64 now = SDL_GetTicksNS();
+
+	while (link->n_delayed > 0) {
+		NetDelayed *next = NULL;
+		for (int i = 0; i < NET_DELAYED_PACKETS; i++) {
+			NetDelayed *packet = &link->delayed[i];
+			if (packet->size > 0 && packet->due <= now && (!next || packet->due < next->due)) {
+				next = packet;
+			}
+		}
+		if (!next) {
+			break;
+		}
+		sendto(link->socket, next->data, next->size, 0, (const struct sockaddr *)&next->to,
+			   sizeof(next->to));
+		next->size = 0;
+		link->n_delayed--;
+	}
+}
+
+/**
+ * Receives a packet, if there is any.
+ *
+ * @return Size of the packet, -1 if there is none
+ */
+static int link_receive(NetLink *link, Uint8 *data, struct sockaddr_in *from)
+{
+	socklen_t length = sizeof(*from);
+	ssize_t size;
+
+	size = recvfrom(link->socket, data, NET_PACKET_SIZE, 0, (struct sockaddr *)from, &length);
+	return (size < 0) ? -1 : (int)size;
+}
+
+/**
+ * Applies a command of the client the way SDL_AppEvent would.
+ */
+static void server_command(Game *game, int command, bool down, Uint64 timestamp)
+{
+	switch (command) {
+	case NET_COMMAND_START:
+		if (game->state == GAME_OVER) {
+			game_reset(game);
+		}
+		game->state = PLAY;
+		break;
+	case NET_COMMAND_PAUSE:
+		if (game->state == PLAY) {
+			game->state = PAUSE;
+		}
+		break;
+	default:
+		if (command <= INPUT_FIRE) {
+			game_input(game, command, down, timestamp);
+		}
+		break;
+	}
+}
+
+/**
+ * Handles a packet from a client. A packet from a new address replaces the current client.
+ */
+static void server_receive(NetServer *server, const Uint8 *data, int size,
+						   const struct sockaddr_in *from)
+{
+	Game *game = server->game;
+	Uint8 commands[NET_INPUT_WINDOW];
+	BitReader bits;
+	Uint32 ack, first;
+	int width, height, n;
+	Uint64 now = SDL_GetTicksNS();
+
+	bits_reader_init(&bits, data, size);
+	if (bits_read(&bits, 8) != NET_PACKET_INPUT) {
+		return;
+	}
+	ack = bits_read(&bits, 32);
+	width = bits_read(&bits, 16);
+	height = bits_read(&bits, 16);
+	first = bits_read(&bits, 32);
+	n = bits_read(&bits, 8);
+	if (n > NET_INPUT_WINDOW) {
+		return;
+	}
+	for (int i = 0; i < n; i++) {
+		commands[i] = bits_read(&bits, 4);
+	}
+	if (bits.overflow) {
+		return;
+	}
+
+	if (!server->connected || from->sin_addr.s_addr != server->client.sin_addr.s_addr
+		|| from->sin_port != server->client.sin_port) {
+		SDL_Log("server: client on port %u connected", ntohs(from->sin_port));
+		server->connected = true;
+		server->client = *from;
+		server->acked = 0;
+		server->inputs = first;
+	}
+	server->heard = now;
+
+	/* Packets can arrive out of order, acknowledgements only move forward */
+	if (ack > server->acked && ack <= server->tick) {
+		server->acked = ack;
+	}
+	if (width != game->width || height != game->height) {
+		game->width = width;
+		game->height = height;
+		game_resize(game);
+	}
+	/* Inputs are resent until acknowledged, skip those already applied */
+	for (int i = 0; i < n; i++) {
+		if ((Sint32)(first + i - server->inputs) >= 0) {
+			server_command(game, commands[i] >> 1, commands[i] & 1, now);
+			server->inputs = first + i + 1;
+		}
+	}
+}
+
+/**
+ * Sends the newest snapshot to the client, against the newest one it acknowledged.
+ */
+static void server_send(NetServer *server, const Snapshot *snapshot, Uint64 start)
+{
+	const Snapshot *baseline = &empty;
+	const Snapshot *acked = &server->history[server->acked % NET_HISTORY];
+	Uint8 packet[NET_PACKET_SIZE];
+	BitWriter bits;
+	Uint64 cost;
+	int size;
+
+	if (server->acked != 0 && server->tick - server->acked < NET_HISTORY
+		&& acked->tick == server->acked) {
+		baseline = acked;
+	}
+
+	bits_writer_init(&bits, packet, sizeof(packet));
+	bits_write(&bits, NET_PACKET_SNAPSHOT, 8);
+	bits_write(&bits, snapshot->tick, 32);
+	bits_write(&bits, baseline->tick, 32);
+	bits_write(&bits, server->inputs, 32);
+	snapshot_write(&bits, snapshot, baseline);
+	size = bits_flush(&bits);
+	cost = elapsed_ns(start);
+	if (size < 0) {
+		SDL_Log("server: snapshot %u doesn't fit in a packet", snapshot->tick);
+		return;
+	}
+	link_send(&server->link, &server->client, packet, size);
+
+	server->bytes += size;
+	server->max_bytes = SDL_max(server->max_bytes, size);
+	server->sent++;
+	server->full += (baseline == &empty);
+	server->serialize_ns += cost;
+	server->serialize_max_ns = SDL_max(server->serialize_max_ns, cost);
+}
+
+/**
+ * Logs what was sent since the last report, and starts counting again.
+ */
+static void server_report(NetServer *server)
+{
+	if (server->sent > 0) {
+		SDL_Log("server: tick %u, %.0f bytes/tick (max %d), %d of %d snapshots full, "
+				"serialization %.1f us/snapshot (max %.1f), %llu of %llu packets dropped",
+				server->tick, (double)server->bytes / server->sent, server->max_bytes,
+				server->full, server->sent, server->serialize_ns / 1000.0 / server->sent,
+				server->serialize_max_ns / 1000.0,
+				(unsigned long long)server->link.dropped_packets,
+				(unsigned long long)server->link.sent_packets);
+	}
+	server->bytes = 0;
+	server->max_bytes = 0;
+	server->sent = 0;
+	server->full = 0;
+	server->serialize_ns = 0;
+	server->serialize_max_ns = 0;
+}
+
+bool net_server_run(Uint16 port, const NetConditions *conditions)
+{
+	NetServer server;
+	Uint8 packet[NET_PACKET_SIZE];
+	struct sockaddr_in from;
+	SDL_Event event;
+	Uint64 frame_ns = SDL_NS_PER_SECOND / FPS;
+	Uint64 next, now;
+	bool running = true;
+	int size;
+
+	SDL_zero(server);
+	/* Only for the quit event Ctrl+C sends */
+	if (!SDL_Init(SDL_INIT_EVENTS)) {
+		SDL_Log("Unable to initialize SDL: %s", SDL_GetError());
+		return false;
+	}
+	if (!game_init(&server.game)) {
+		SDL_Log("Couldn't initialize game");
+		return false;
+	}
+	server.history = calloc(NET_HISTORY, sizeof(Snapshot));
+	if (!server.history) {
+		SDL_Log("Couldn't allocate memory: %s", SDL_GetError());
+		game_free(server.game);
+		return false;
+	}
+	if (!link_open(&server.link, port, conditions)) {
+		free(server.history);
+		game_free(server.game);
+		return false;
+	}
+	SDL_Log("server: listening on 127.0.0.1:%u", port);
+
+	next = SDL_GetTicksNS();
+	while (running) {
+		now = SDL_GetTicksNS();
+		if (now < next) {
+			SDL_DelayNS(next - now);
+		} else if (now - next > FPS * frame_ns) {
+			/* Stalled for over a second, don't try to catch up */
+			next = now;
+		}
+		next += frame_ns;
+		Uint64 frame_start = SDL_GetTicksNS();
+
+		while (SDL_PollEvent(&event)) {
+			if (event.type == SDL_EVENT_QUIT) {
+				running = false;
+			}
+		}
+
+		while ((size = link_receive(&server.link, packet, &from)) >= 0) {
+			server_receive(&server, packet, size, &from);
+		}
+		if (server.connected && SDL_GetTicksNS() - server.heard > NET_TIMEOUT * SDL_NS_PER_SECOND) {
+			SDL_Log("server: client timed out");
+			server.connected = false;
+		}
+
+		if (server.game->state == PLAY) {
+			server.game->time = SDL_GetTicksNS();
+			game_update_frame(server.game);
+		}
+		server.tick++;
+
+		Uint64 start = SDL_GetPerformanceCounter();
+		Snapshot *snapshot = &server.history[server.tick % NET_HISTORY];
+		snapshot_capture(snapshot, server.game, server.tick);
+		if (server.connected) {
+			server_send(&server, snapshot, start);
+		}
+		link_pump(&server.link);
+
+		if (server.tick % NET_REPORT_INTERVAL == 0) {
+			server_report(&server);
+		}
+		telemetry_frame(server.game, frame_start);
+	}
+
+	server_report(&server);
+	link_close(&server.link);
+	free(server.history);
+	game_free(server.game);
+	return true;
+}
+
+bool net_client_open(NetClient *client, Uint16 port, const NetConditions *conditions)
+{
+	SDL_zerop(client);
+	client->history = calloc(NET_HISTORY, sizeof(Snapshot));
+	if (!client->history) {
+		SDL_Log("Couldn't allocate memory: %s", SDL_GetError());
+		return false;
+	}
+	if (!link_open(&client->link, 0, conditions)) {
+		free(client->history);
+		return false;
+	}
+	client->server = loopback(port);
+	client->last_update = SDL_GetTicksNS();
+	SDL_Log("client: playing on 127.0.0.1:%u", port);
+
+	return true;
+}
+
+void net_client_input(NetClient *client, int command, bool down)
+{
+	if (client->n_inputs == NET_INPUT_WINDOW) {
+		SDL_Log("client: too many inputs waiting for the server, dropping one");
+		return;
+	}
+	client->inputs[client->n_inputs++] = (Uint8)(command << 1 | down);
+	client->next_input++;
+}
+
+/**
+ * Decodes a snapshot from the server, and forgets the inputs it acknowledges.
+ */
+static void client_receive(NetClient *client, const Uint8 *data, int size)
+{
+	const Snapshot *baseline = &empty;
+	Snapshot *snapshot;
+	BitReader bits;
+	Uint32 tick, baseline_tick, applied, first;
+	Uint64 start = SDL_GetPerformanceCounter();
+	Uint64 cost;
+
+	bits_reader_init(&bits, data, size);
+	if (bits_read(&bits, 8) != NET_PACKET_SNAPSHOT) {
+		return;
+	}
+	tick = bits_read(&bits, 32);
+	baseline_tick = bits_read(&bits, 32);
+	applied = bits_read(&bits, 32);
+	snapshot = &client->history[tick % NET_HISTORY];
+	/* Too old to keep, or already received */
+	if (bits.overflow || tick == 0 || (client->latest >= NET_HISTORY
+									   && tick <= client->latest - NET_HISTORY)
+		|| snapshot->tick == tick) {
+		return;
+	}
+	if (baseline_tick != 0) {
+		baseline = &client->history[baseline_tick % NET_HISTORY];
+		if (baseline->tick != baseline_tick) {
+			client->undecodable++;
+			return;
+		}
+	}
+
+	snapshot->tick = tick;
+	if (!snapshot_read(&bits, snapshot, baseline)) {
+		SDL_Log("client: snapshot %u is invalid", tick);
+		snapshot->tick = 0;
+		return;
+	}
+	cost = elapsed_ns(start);
+
+	if (tick > client->latest) {
+		if (client->latest != 0) {
+			client->missed += tick - client->latest - 1;
+		}
+		client->latest = tick;
+	}
+	client->received++;
+	client->received_bytes += size;
+	client->decode_ns += cost;
+	client->decode_max_ns = SDL_max(client->decode_max_ns, cost);
+
+	/* Acknowledgements can arrive out of order too */
+	first = client->next_input - client->n_inputs;
+	if ((Sint32)(applied - first) > 0 && (Sint32)(applied - client->next_input) <= 0) {
+		int done = applied - first;
+		client->n_inputs -= done;
+		SDL_memmove(client->inputs, client->inputs + done, client->n_inputs);
+	}
+}
+
+/**
+ * Sends the newest snapshot received, the window size and every input not acknowledged yet.
+ */
+static void client_send(NetClient *client, Game *game)
+{
+	Uint8 packet[NET_PACKET_SIZE];
+	BitWriter bits;
+	int size;
+
+	bits_writer_init(&bits, packet, sizeof(packet));
+	bits_write(&bits, NET_PACKET_INPUT, 8);
+	bits_write(&bits, client->latest, 32);
+	bits_write(&bits, game->width, 16);
+	bits_write(&bits, game->height, 16);
+	bits_write(&bits, client->next_input - client->n_inputs, 32);
+	bits_write(&bits, client->n_inputs, 8);
+	for (int i = 0; i < client->n_inputs; i++) {
+		bits_write(&bits, client->inputs[i], 4);
+	}
+	size = bits_flush(&bits);
+	link_send(&client->link, &client->server, packet, size);
+}
+
+/**
+ * Loads the two received snapshots around the playback tick into the game.
+ */
+static void client_load(NetClient *client, Game *game)
+{
+	const Snapshot *from = NULL, *to = NULL;
+	Uint32 base = (client->playback < 1) ? 1 : (Uint32)client->playback;
+	float t = 0;
+
+	for (Uint32 tick = base; tick > 0 && base - tick < NET_HISTORY; tick--) {
+		if (client->history[tick % NET_HISTORY].tick == tick) {
+			from = &client->history[tick % NET_HISTORY];
+			break;
+		}
+	}
+	for (Uint32 tick = base + 1; tick <= client->latest && tick - base < NET_HISTORY; tick++) {
+		if (client->history[tick % NET_HISTORY].tick == tick) {
+			to = &client->history[tick % NET_HISTORY];
+			break;
+		}
+	}
+	if (!from) {
+		from = to;
+		to = NULL;
+	}
+	if (!from) {
+		return;
+	}
+	if (to) {
+		t = (float)((client->playback - from->tick) / (to->tick - from->tick));
+		t = SDL_clamp(t, 0.0f, 1.0f);
+	}
+	snapshot_load(game, from, to, t);
+}
+
+/**
+ * Logs what was received since the last report, and starts counting again.
+ */
+static void client_report(NetClient *client)
+{
+	if (client->received > 0) {
+		SDL_Log("client: %.0f bytes/snapshot, %d received, %d skipped, %d undecodable (baseline "
+				"missing), decoding %.1f us/snapshot (max %.1f), %.1f ticks behind, %llu of %llu "
+				"packets dropped",
+				(double)client->received_bytes / client->received, client->received,
+				client->missed, client->undecodable, client->decode_ns / 1000.0 / client->received,
+				client->decode_max_ns / 1000.0, client->latest - client->playback,
+				(unsigned long long)client->link.dropped_packets,
+				(unsigned long long)client->link.sent_packets);
+	}
+	client->received_bytes = 0;
+	client->received = 0;
+	client->missed = 0;
+	client->undecodable = 0;
+	client->decode_ns = 0;
+	client->decode_max_ns = 0;
+	client->frames = 0;
+}
+
+void net_client_update(NetClient *client, Game *game)
+{
+	Uint8 packet[NET_PACKET_SIZE];
+	struct sockaddr_in from;
+	Uint64 now = SDL_GetTicksNS();
+	double target;
+	int size;
+
+	while ((size = link_receive(&client->link, packet, &from)) >= 0) {
+		client_receive(client, packet, size);
+	}
+	client_send(client, game);
+	link_pump(&client->link);
+
+	/* Playback follows the clock, and is nudged to stay a few ticks behind the newest snapshot */
+	client->playback += (double)(now - client->last_update) * FPS / SDL_NS_PER_SECOND;
+	client->last_update = now;
+	if (client->latest != 0) {
+		target = (double)client->latest - NET_INTERPOLATION_TICKS;
+		if (SDL_fabs(target - client->playback) > NET_INTERPOLATION_TICKS) {
+			/* At the start, or after a stall */
+			client->playback = target;
+		} else {
+			client->playback += (target - client->playback) * NET_CATCH_UP;
+		}
+		client->playback = SDL_min(client->playback, client->latest);
+		client_load(client, game);
+	}
+
+	if (++client->frames == NET_REPORT_INTERVAL) {
+		client_report(client);
+	}
+}
+
+void net_client_close(NetClient *client)
+{
+	client_report(client);
+	link_close(&client->link);
+	free(client->history);
+	client->history = NULL;
+}
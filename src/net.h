@@ -0,0 +1,166 @@
+#ifndef NET_H
+#define NET_H
+
+#include <stdbool.h>
+
+#include <netinet/in.h>
+
+#include <SDL3/SDL_stdinc.h>
+
+#include "game.h"
+#include "snapshot.h"
+
+/**
+ * The game played over UDP on the loopback interface. The server runs the simulation headless and
+ * sends a snapshot every tick, encoded against the newest one the client acknowledged. The client
+ * sends its inputs back, draws the snapshots slightly in the past and interpolates between them.
+ *
+ * Inputs are numbered and resent until the server acknowledges them, so lost packets only delay
+ * them. Lost snapshots need nothing resent: the next one is encoded against an older baseline.
+ *
+ * Both ends can simulate a bad network on the packets they send: some are dropped, and the rest
+ * are held back for a latency plus a random jitter.
+ */
+
+/**
+ * @brief Port the server listens on when none is given
+ */
+#define NET_PORT 27960
+/**
+ * @brief Largest packet. Full snapshots are bigger than an Ethernet MTU, loopback doesn't mind.
+ */
+#define NET_PACKET_SIZE 8192
+/**
+ * @brief Snapshots both ends keep. Older acknowledgements are ignored, and a full one is sent.
+ */
+#define NET_HISTORY 64
+/**
+ * @brief Inputs the client keeps until the server acknowledges them. More are dropped.
+ */
+#define NET_INPUT_WINDOW 64
+/**
+ * @brief Packets held back by the simulated latency at most. More are dropped.
+ */
+#define NET_DELAYED_PACKETS 64
+/**
+ * @brief Ticks the client draws behind the newest snapshot, so it has one to interpolate to
+ */
+#define NET_INTERPOLATION_TICKS 3
+/**
+ * @brief Seconds without packets after which the server forgets its client
+ */
+#define NET_TIMEOUT 3
+/**
+ * @brief Ticks between two traffic reports
+ */
+#define NET_REPORT_INTERVAL (5 * FPS)
+
+/**
+ * Commands a client sends besides the InputAction ones.
+ */
+typedef enum {
+	NET_COMMAND_START = INPUT_FIRE + 1, /**< Any key on the menu, pause or game over screens */
+	NET_COMMAND_PAUSE,					/**< Pause the game */
+} NetCommand;
+
+/**
+ * How bad the simulated network is.
+ */
+typedef struct {
+	float loss;		/**< Fraction of the packets dropped, 0 to 1 */
+	Uint32 latency;	/**< Time every packet is held back, in ms */
+	Uint32 jitter;	/**< Extra random time some packets are held back, in ms */
+} NetConditions;
+
+/**
+ * A packet held back by the simulated latency.
+ */
+typedef struct {
+	Uint64 due;					 /**< When it has to be sent, in ns */
+	struct sockaddr_in to;		 /**< Where it goes */
+	int size;					 /**< Size of the packet */
+	Uint8 data[NET_PACKET_SIZE]; /**< The packet */
+} NetDelayed;
+
+/**
+ * A UDP socket that sends through the simulated network.
+ */
+typedef struct {
+	int socket;				  /**< The socket, non blocking */
+	NetConditions conditions; /**< How bad the network is */
+	Uint64 rng;				  /**< State of the loss and jitter generator */
+	NetDelayed* delayed;	  /**< Packets held back, NET_DELAYED_PACKETS of them */
+	int n_delayed;			  /**< Number of packets held back */
+	Uint64 sent_bytes;		  /**< Bytes handed to the link, including dropped ones */
+	Uint64 sent_packets;	  /**< Packets handed to the link */
+	Uint64 dropped_packets;	  /**< Packets the simulated network dropped */
+} NetLink;
+
+/**
+ * The client end. It only draws what the server sends.
+ */
+typedef struct {
+	NetLink link;					/**< Socket to the server */
+	struct sockaddr_in server;		/**< Address of the server */
+	Snapshot* history;				/**< Snapshots received, by tick modulo NET_HISTORY */
+	Uint32 latest;					/**< Newest tick received, 0 if none */
+	double playback;				/**< Tick being drawn, fractional */
+	Uint64 last_update;				/**< When net_client_update() last ran, in ns */
+	Uint8 inputs[NET_INPUT_WINDOW];	/**< Inputs not acknowledged yet, oldest first */
+	int n_inputs;					/**< Number of inputs not acknowledged yet */
+	Uint32 next_input;				/**< Number of the next input */
+	Uint64 received_bytes;			/**< Bytes of the snapshots received since the last report */
+	int received;					/**< Snapshots received since the last report */
+	int missed;						/**< Ticks never received since the last report */
+	int undecodable;				/**< Snapshots whose baseline was gone since the last report */
+	Uint64 decode_ns;				/**< Time spent decoding since the last report */
+	Uint64 decode_max_ns;			/**< Longest decode since the last report */
+	int frames;						/**< Updates since the last report */
+} NetClient;
+
+/**
+ * Runs a headless server on the loopback interface until it is interrupted. Traffic and
+ * serialization costs are logged every NET_REPORT_INTERVAL ticks.
+ *
+ * @param port Port to listen on
+ * @param conditions How bad the simulated network is
+ * @return True if it stopped because it was asked to, false on error
+ */
+bool net_server_run(Uint16 port, const NetConditions *conditions);
+
+/**
+ * Starts a client for a server on the loopback interface.
+ *
+ * @param client The client to initialize
+ * @param port Port of the server
+ * @param conditions How bad the simulated network is
+ * @return True if it was started, false otherwise
+ */
+bool net_client_open(NetClient *client, Uint16 port, const NetConditions *conditions);
+
+/**
+ * Queues a key press or release to be sent to the server.
+ *
+ * @param client The client
+ * @param command An InputAction or a NetCommand
+ * @param down Whether the key was pressed or released
+ */
+void net_client_input(NetClient *client, int command, bool down);
+
+/**
+ * Receives snapshots, sends the pending inputs, and loads the state to draw into a game. Meant to
+ * be called once per frame, instead of game_update_frame().
+ *
+ * @param client The client
+ * @param game Game to load the state into. Its window size is sent to the server.
+ */
+void net_client_update(NetClient *client, Game *game);
+
+/**
+ * Closes the client.
+ *
+ * @param client The client to close
+ */
+void net_client_close(NetClient *client);
+
+#endif	// !NET_H
@@ -0,0 +1,119 @@
+#include "profile.h"
+
+#ifdef PROFILE
+
+#include <SDL3/SDL_atomic.h>
+#include <SDL3/SDL_iostream.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_thread.h>
+
+/**
+ * A closed zone
+ */
+typedef struct {
+	const char *name; /**< Name of the zone */
+	Uint64 start;	  /**< Performance counter when the zone was opened */
+	Uint64 end;		  /**< Performance counter when the zone was closed */
+} ProfileEvent;
+
+/**
+ * Ring buffer with the last zones closed by one thread. Only that thread writes to it.
+ */
+typedef struct {
+	SDL_ThreadID thread;				  /**< Thread that owns the buffer */
+	Uint64 head;						  /**< Number of zones ever recorded */
+	ProfileEvent events[PROFILE_EVENTS]; /**< The last PROFILE_EVENTS zones */
+} ProfileBuffer;
+
+/**
+ * Every buffer is preallocated, threads claim one the first time they close a zone
+ */
+static ProfileBuffer buffers[PROFILE_MAX_THREADS];
+/**
+ * Number of buffers claimed
+ */
+static SDL_AtomicInt n_buffers;
+/**
+ * Buffer of the calling thread, NULL until claimed
+ */
+static _Thread_local ProfileBuffer *buffer;
+/**
+ * Set once a thread couldn't get a buffer, so the warning is logged once
+ */
+static _Thread_local bool no_buffer;
+
+void profile_zone_end(ProfileZone *zone)
+{
+	Uint64 end = SDL_GetPerformanceCounter();
+
+	if (!buffer) {
+		if (no_buffer)
+			return;
+		int index = SDL_AddAtomicInt(&n_buffers, 1);
+		if (index >= PROFILE_MAX_THREADS) {
+			no_buffer = true;
+			SDL_Log("Too many threads to profile, PROFILE_MAX_THREADS is %d", PROFILE_MAX_THREADS);
+			return;
+		}
+		buffer = &buffers[index];
+		buffer->thread = SDL_GetCurrentThreadID();
+	}
+
+	buffer->events[buffer->head++ & (PROFILE_EVENTS - 1)]
+	  = (ProfileEvent){ .name = zone->name, .start = zone->start, .end = end };
+}
+
+void profile_dump(const char *path)
+{
+	SDL_IOStream *file;
+	int n = SDL_GetAtomicInt(&n_buffers);
+	double us_per_tick = 1000000.0 / SDL_GetPerformanceFrequency();
+	Uint64 origin = SDL_MAX_UINT64;
+	bool first = true;
+
+	if (n > PROFILE_MAX_THREADS)
+		n = PROFILE_MAX_THREADS;
+
+	/* Timestamps are relative to the oldest zone kept, so they stay readable */
+	for (int i = 0; i < n; i++) {
+		ProfileBuffer *b = &buffers[i];
+		Uint64 kept = b->head < PROFILE_EVENTS ? b->head : PROFILE_EVENTS;
+		for (Uint64 e = b->head - kept; e < b->head; e++) {
+			if (b->events[e & (PROFILE_EVENTS - 1)].start < origin)
+				origin = b->events[e & (PROFILE_EVENTS - 1)].start;
+		}
+	}
+
+	file = SDL_IOFromFile(path, "w");
+	if (!file) {
+		SDL_Log("Couldn't write trace: %s", SDL_GetError());
+		return;
+	}
+
+	SDL_IOprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	for (int i = 0; i < n; i++) {
+		ProfileBuffer *b = &buffers[i];
+		Uint64 kept = b->head < PROFILE_EVENTS ? b->head : PROFILE_EVENTS;
+
+		for (Uint64 e = b->head - kept; e < b->head; e++) {
+			ProfileEvent *event = &b->events[e & (PROFILE_EVENTS - 1)];
+			SDL_IOprintf(file,
+						 "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%llu,\"ts\":%.3f,"
+						 "\"dur\":%.3f}",
+						 first ? "" : ",", event->name, (unsigned long long)b->thread,
+						 (event->start - origin) * us_per_tick,
+						 (event->end - event->start) * us_per_tick);
+			first = false;
+		}
+		if (b->head > kept) {
+			SDL_Log("Profiler dropped the %llu oldest zones of thread %llu",
+					(unsigned long long)(b->head - kept), (unsigned long long)b->thread);
+		}
+	}
+	SDL_IOprintf(file, "\n]}\n");
+	SDL_CloseIO(file);
+
+	SDL_Log("Trace written to %s", path);
+}
+
+#endif	// PROFILE
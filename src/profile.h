@@ -0,0 +1,78 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/**
+ * Scoped timing zones, exported as Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev).
+ *
+ * Only compiled in when PROFILE is defined (make PROFILE=1). Otherwise every macro expands to
+ * nothing.
+ */
+
+/**
+ * @brief File the trace is written to on exit
+ */
+#define PROFILE_OUTPUT "asteroid-trace.json"
+
+#ifdef PROFILE
+
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_timer.h>
+
+#include "jobs.h"
+
+/**
+ * @brief Zones kept per thread. Older ones are overwritten. Must be a power of two.
+ */
+#define PROFILE_EVENTS (1 << 15)
+/**
+ * @brief Maximum number of threads that can record zones: every thread running jobs, and a few
+ * more of their own (capture writer, stats reader)
+ */
+#define PROFILE_MAX_THREADS (JOBS_MAX_THREADS + 4)
+
+/**
+ * An open zone. Closed automatically when it goes out of scope.
+ */
+typedef struct {
+	const char *name; /**< Name of the zone, must be a string literal */
+	Uint64 start;	  /**< Performance counter when the zone was opened */
+} ProfileZone;
+
+/**
+ * Closes a zone and records it into the buffer of the calling thread. Never allocates.
+ *
+ * @param zone The zone to close
+ */
+void profile_zone_end(ProfileZone *zone);
+
+/**
+ * Writes every recorded zone of every thread as a Chrome trace. Call it once no thread is
+ * recording anymore.
+ *
+ * @param path File to write
+ */
+void profile_dump(const char *path);
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+/**
+ * Opens a zone that lasts until the end of the enclosing scope.
+ */
+#define PROFILE_ZONE(name)                                                         \
+	ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)                            \
+	  __attribute__((cleanup(profile_zone_end))) = { name, SDL_GetPerformanceCounter() }
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define profile_dump(path) ((void)0)
+
+#endif	// PROFILE
+
+/**
+ * Opens a zone named after the enclosing function.
+ */
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+
+#endif	// !PROFILE_H
@@ -0,0 +1,330 @@
+#include "query.h"
+
+#include <stdlib.h>
+
+#include <SDL3/SDL_log.h>
+
+#include "profile.h"
+
+/**
+ * Finds the cell a coordinate falls in, along one axis. Points outside the world go to the
+ * closest cell.
+ */
+static inline int query_cell(Real coordinate, int cells)
+{
+	return SDL_clamp((int)(coordinate / REAL(QUERY_CELL)), 0, cells - 1);
+}
+
+/**
+ * Allocates a snapshot.
+ *
+ * @return True if it was allocated, false otherwise
+ */
+static bool query_snapshot_init(QuerySnapshot *snapshot, int columns, int rows, int capacity)
+{
+	snapshot->tick = 0;
+	snapshot->columns = columns;
+	snapshot->rows = rows;
+	snapshot->count = 0;
+	snapshot->cell_start = calloc(columns * rows + 1, sizeof(int));
+	snapshot->entries = malloc(capacity * sizeof(QueryEntry));
+	SDL_SetAtomicInt(&snapshot->readers, 0);
+
+	return snapshot->cell_start && snapshot->entries;
+}
+
+bool query_init(QueryIndex *index, Game *game)
+{
+	int capacity = game->asteroids.capacity;
+
+	SDL_zerop(index);
+	index->columns = game->world_width / QUERY_CELL + 1;
+	index->rows = game->world_height / QUERY_CELL + 1;
+	index->cells = malloc(capacity * sizeof(int));
+	index->next = malloc((index->columns * index->rows + 1) * sizeof(int));
+	SDL_SetAtomicInt(&index->current, -1);
+	if (!index->cells || !index->next
+		|| !query_snapshot_init(&index->snapshots[0], index->columns, index->rows, capacity)
+		|| !query_snapshot_init(&index->snapshots[1], index->columns, index->rows, capacity)) {
+		SDL_Log("Couldn't allocate memory: %s", SDL_GetError());
+		query_free(index);
+		return false;
+	}
+
+	return true;
+}
+
+void query_free(QueryIndex *index)
+{
+	for (int i = 0; i < 2; i++) {
+		free(index->snapshots[i].cell_start);
+		free(index->snapshots[i].entries);
+	}
+	free(index->cells);
+	free(index->next);
+	SDL_zerop(index);
+	SDL_SetAtomicInt(&index->current, -1);
+}
+
+void query_update(QueryIndex *index, Game *game)
+{
+	PROFILE_FUNCTION();
+	Store *store = &game->asteroids;
+	int *cells = index->cells;
+	int *next = index->next;
+	int n_cells = index->columns * index->rows;
+
+	/* Asteroids in each cell, one slot further, so that adding them up gives where cells start */
+	SDL_memset(next, 0, (n_cells + 1) * sizeof(int));
+	for (int i = 0; i < store->count; i++) {
+		Asteroid asteroid = asteroid_get(game, i);
+		cells[i] = query_cell(asteroid.y, index->rows) * index->columns
+				   + query_cell(asteroid.x, index->columns);
+		next[cells[i] + 1]++;
+	}
+	for (int cell = 1; cell <= n_cells; cell++) {
+		next[cell] += next[cell - 1];
+	}
+
+	/* The other snapshot, once the threads still on it are done */
+	int target = (SDL_GetAtomicInt(&index->current) == 0) ? 1 : 0;
+	QuerySnapshot *snapshot = &index->snapshots[target];
+	while (SDL_GetAtomicInt(&snapshot->readers) > 0) {
+		SDL_CPUPauseInstruction();
+	}
+
+	SDL_memcpy(snapshot->cell_start, next, (n_cells + 1) * sizeof(int));
+	for (int i = 0; i < store->count; i++) {
+		Asteroid asteroid = asteroid_get(game, i);
+		snapshot->entries[next[cells[i]]++] = (QueryEntry){
+			.handle = store->handles[i],
+			.x = asteroid.x,
+			.y = asteroid.y,
+			.radius = asteroid.radius,
+		};
+	}
+	snapshot->count = store->count;
+	snapshot->tick = game->tick;
+
+	/* Everything above is visible to whoever sees it published */
+	SDL_MemoryBarrierRelease();
+	SDL_SetAtomicInt(&index->current, target);
+}
+
+const QuerySnapshot *query_acquire(QueryIndex *index)
+{
+	for (;;) {
+		int current = SDL_GetAtomicInt(&index->current);
+		if (current == -1) {
+			return NULL;
+		}
+		QuerySnapshot *snapshot = &index->snapshots[current];
+		SDL_AddAtomicInt(&snapshot->readers, 1);
+		/* Still published after counting ourselves in, so no update can be filling it */
+		if (SDL_GetAtomicInt(&index->current) == current) {
+			SDL_MemoryBarrierAcquire();
+			return snapshot;
+		}
+		SDL_AddAtomicInt(&snapshot->readers, -1);
+	}
+}
+
+void query_release(QueryIndex *index, const QuerySnapshot *snapshot)
+{
+	SDL_AddAtomicInt(&index->snapshots[snapshot - index->snapshots].readers, -1);
+}
+
+/**
+ * Describes an asteroid of a snapshot to the caller.
+ */
+static inline QueryHit query_hit(const QueryEntry *entry, Real distance)
+{
+	return (QueryHit){ .handle = entry->handle,
+					   .x = entry->x,
+					   .y = entry->y,
+					   .radius = entry->radius,
+					   .distance = distance };
+}
+
+/**
+ * Keeps the closest asteroids among those of a span of cells in a row.
+ *
+ * @param snapshot The snapshot
+ * @param row Row of the cells, may be outside the grid
+ * @param first First column of the span, may be outside the grid
+ * @param last Last column of the span, may be outside the grid
+ * @param x X position of the point
+ * @param y Y position of the point
+ * @param k Number of asteroids to keep
+ * @param hits The asteroids kept, closest first
+ * @param found Number of asteroids kept
+ */
+static void query_nearest_span(const QuerySnapshot *snapshot, int row, int first, int last, Real x,
+							   Real y, int k, QueryHit *hits, int *found)
+{
+	first = SDL_max(first, 0);
+	last = SDL_min(last, snapshot->columns - 1);
+	if (row < 0 || row >= snapshot->rows || first > last) {
+		return;
+	}
+
+	int end = snapshot->cell_start[row * snapshot->columns + last + 1];
+	for (int a = snapshot->cell_start[row * snapshot->columns + first]; a < end; a++) {
+		const QueryEntry *entry = &snapshot->entries[a];
+		Real dx = entry->x - x;
+		Real dy = entry->y - y;
+		Real distance = real_sqrt((RealWide)dx * dx + (RealWide)dy * dy) - entry->radius;
+		if (*found == k && distance >= hits[k - 1].distance) {
+			continue;
+		}
+		/* The first one found wins ties */
+		int j = (*found < k) ? (*found)++ : k - 1;
+		while (j > 0 && hits[j - 1].distance > distance) {
+			hits[j] = hits[j - 1];
+			j--;
+		}
+		hits[j] = query_hit(entry, distance);
+	}
+}
+
+int query_nearest(const QuerySnapshot *snapshot, Real x, Real y, int k, QueryHit *hits)
+{
+	int column = query_cell(x, snapshot->columns);
+	int row = query_cell(y, snapshot->rows);
+	int rings = SDL_max(SDL_max(column, snapshot->columns - 1 - column),
+						SDL_max(row, snapshot->rows - 1 - row));
+	int found = 0;
+
+	if (k <= 0) {
+		return 0;
+	}
+	/* Rings of cells around the one of the point, until the next one can't be any closer */
+	for (int ring = 0; ring <= rings; ring++) {
+		if (found == k
+			&& (ring - 1) * REAL(QUERY_CELL) - REAL(ASTEROID_RADIUS_MAX) > hits[k - 1].distance) {
+			break;
+		}
+		query_nearest_span(snapshot, row - ring, column - ring, column + ring, x, y, k, hits,
+						   &found);
+		if (ring == 0) {
+			continue;
+		}
+		query_nearest_span(snapshot, row + ring, column - ring, column + ring, x, y, k, hits,
+						   &found);
+		for (int r = SDL_max(row - ring + 1, 0); r < SDL_min(row + ring, snapshot->rows); r++) {
+			query_nearest_span(snapshot, r, column - ring, column - ring, x, y, k, hits, &found);
+			query_nearest_span(snapshot, r, column + ring, column + ring, x, y, k, hits, &found);
+		}
+	}
+
+	return found;
+}
+
+int query_radius(const QuerySnapshot *snapshot, Real x, Real y, Real radius, int max,
+				 QueryHit *hits)
+{
+	/* Asteroids touching the circle have their centers that much further at most */
+	Real reach = radius + REAL(ASTEROID_RADIUS_MAX);
+	int first_column = query_cell(x - reach, snapshot->columns);
+	int last_column = query_cell(x + reach, snapshot->columns);
+	int last_row = query_cell(y + reach, snapshot->rows);
+	int found = 0;
+
+	for (int row = query_cell(y - reach, snapshot->rows); row <= last_row; row++) {
+		int end = snapshot->cell_start[row * snapshot->columns + last_column + 1];
+		for (int a = snapshot->cell_start[row * snapshot->columns + first_column]; a < end; a++) {
+			const QueryEntry *entry = &snapshot->entries[a];
+			Real dx = entry->x - x;
+			Real dy = entry->y - y;
+			RealWide dist_sq = (RealWide)dx * dx + (RealWide)dy * dy;
+			Real touch = radius + entry->radius;
+			if (dist_sq > (RealWide)touch * touch) {
+				continue;
+			}
+			if (found < max) {
+				hits[found] = query_hit(entry, real_sqrt(dist_sq) - entry->radius);
+			}
+			found++;
+		}
+	}
+
+	return found;
+}
+
+/**
+ * Finds where a ray enters an asteroid.
+ *
+ * @param entry The asteroid
+ * @param x X position of the start of the ray
+ * @param y Y position of the start of the ray
+ * @param dx X of the direction of the ray, of length 1
+ * @param dy Y of the direction of the ray
+ * @param t Where to put how far along the ray it enters, 0 if it starts inside
+ * @return True if the ray goes through the asteroid, false otherwise
+ */
+static bool query_ray_hits(const QueryEntry *entry, Real x, Real y, Real dx, Real dy, Real *t)
+{
+	Real ex = entry->x - x;
+	Real ey = entry->y - y;
+	/* How far along the ray the center is, and how far the start is outside of the edge */
+	Real along = REAL_MUL(ex, dx) + REAL_MUL(ey, dy);
+	RealWide outside = (RealWide)ex * ex + (RealWide)ey * ey
+					   - (RealWide)entry->radius * entry->radius;
+
+	if (outside <= 0) {
+		*t = 0;
+		return true;
+	}
+	if (along < 0) {
+		return false;
+	}
+	RealWide half_chord_sq = (RealWide)along * along - outside;
+	if (half_chord_sq < 0) {
+		return false;
+	}
+	*t = along - real_sqrt(half_chord_sq);
+	return true;
+}
+
+bool query_ray(const QuerySnapshot *snapshot, Real x, Real y, Real dx, Real dy, Real length,
+			   QueryHit *hit)
+{
+	Real step = REAL(QUERY_CELL / 2);
+	int last_cell = -1;
+	bool found = false;
+
+	/*
+	 * Sampled every half cell. The center of an asteroid the ray enters is in the cells around the
+	 * sample right before that point.
+	 */
+	for (Real t = 0; t <= length; t += step) {
+		/* Every point closer than the hit has a sample before it, already looked around */
+		if (found && t > hit->distance) {
+			break;
+		}
+		int column = query_cell(x + REAL_MUL(dx, t), snapshot->columns);
+		int row = query_cell(y + REAL_MUL(dy, t), snapshot->rows);
+		if (row * snapshot->columns + column == last_cell) {
+			continue;
+		}
+		last_cell = row * snapshot->columns + column;
+
+		int first_column = SDL_max(column - 1, 0);
+		int last_column = SDL_min(column + 1, snapshot->columns - 1);
+		for (int r = SDL_max(row - 1, 0); r <= SDL_min(row + 1, snapshot->rows - 1); r++) {
+			int end = snapshot->cell_start[r * snapshot->columns + last_column + 1];
+			for (int a = snapshot->cell_start[r * snapshot->columns + first_column]; a < end;
+				 a++) {
+				const QueryEntry *entry = &snapshot->entries[a];
+				Real t_entry;
+				if (query_ray_hits(entry, x, y, dx, dy, &t_entry) && t_entry <= length
+					&& (!found || t_entry < hit->distance)) {
+					*hit = query_hit(entry, t_entry);
+					found = true;
+				}
+			}
+		}
+	}
+
+	return found;
+}
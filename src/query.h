@@ -0,0 +1,162 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <stdbool.h>
+
+#include <SDL3/SDL_atomic.h>
+#include <SDL3/SDL_stdinc.h>
+
+#include "config.h"
+#include "game.h"
+#include "real.h"
+#include "store.h"
+
+/**
+ * Spatial queries on the asteroids, for bots: the nearest ones to a point, the ones within a
+ * distance of it, and the first one along a ray.
+ *
+ * The index buckets the asteroids by the cell of a uniform grid they are in, with a counting sort
+ * redone after every tick: two passes over the asteroids in store order, whatever moved, split or
+ * died. Each update fills a snapshot that never changes afterwards, so that any number of threads
+ * can query it at the same time, while the game runs its next tick.
+ *
+ * Queries only look at the cells around what they search for, and visit the asteroids of a row of
+ * cells in one go.
+ */
+
+/**
+ * @brief Side of the cells of the index. At least twice the biggest radius, so that a ray meets
+ * every asteroid it hits in the cells around the points it is sampled at.
+ */
+#define QUERY_CELL (4 * ASTEROID_RADIUS_MAX)
+
+/**
+ * An asteroid found by a query.
+ */
+typedef struct {
+	Handle handle; /**< Handle of the asteroid in the store */
+	Real x;		   /**< X position of the asteroid */
+	Real y;		   /**< Y position of the asteroid */
+	Real radius;   /**< Radius of the asteroid */
+	Real distance; /**< From the point to its edge, negative inside, or along the ray */
+} QueryHit;
+
+/**
+ * An asteroid in a snapshot, what queries read of it.
+ */
+typedef struct {
+	Handle handle; /**< Handle of the asteroid in the store */
+	Real x;		   /**< X position of the asteroid */
+	Real y;		   /**< Y position of the asteroid */
+	Real radius;   /**< Radius of the asteroid */
+} QueryEntry;
+
+/**
+ * The asteroids after a tick, sorted by cell. Read only once published.
+ */
+typedef struct {
+	Uint64 tick;		   /**< Tick it was taken after */
+	int columns;		   /**< Cells along X */
+	int rows;			   /**< Cells along Y */
+	int count;			   /**< Number of asteroids */
+	int* cell_start;	   /**< First asteroid of each cell, and one past the last */
+	QueryEntry* entries;   /**< The asteroids, cell by cell, in store order within a cell */
+	SDL_AtomicInt readers; /**< Threads querying it, it isn't updated until there are none */
+} QuerySnapshot;
+
+/**
+ * The index, and the two snapshots it fills in turn.
+ */
+typedef struct {
+	QuerySnapshot snapshots[2]; /**< Snapshots, one published and one being filled */
+	SDL_AtomicInt current;		/**< Published snapshot, -1 before the first update */
+	int* cells;					/**< Cell of every dense asteroid, in updates */
+	int* next;					/**< Where the next asteroid of each cell goes, in updates */
+	int columns;				/**< Cells along X */
+	int rows;					/**< Cells along Y */
+} QueryIndex;
+
+/**
+ * Allocates an index for the asteroids of a game.
+ *
+ * @param index The index to initialize
+ * @param game The game, only its world size and store capacity are used
+ * @return True if it was allocated, false otherwise
+ */
+bool query_init(QueryIndex *index, Game *game);
+
+/**
+ * Frees an index. No thread may still be querying it.
+ *
+ * @param index The index to free
+ */
+void query_free(QueryIndex *index);
+
+/**
+ * Sorts the asteroids into the cells again, and publishes a new snapshot of them. Called between
+ * ticks, by the thread running them. Waits for the threads still querying the snapshot
+ * before the current one to release it.
+ *
+ * @param index The index
+ * @param game The game
+ */
+void query_update(QueryIndex *index, Game *game);
+
+/**
+ * Takes the last published snapshot, for the calling thread to query.
+ *
+ * @param index The index
+ * @return The snapshot, NULL if nothing was published yet
+ */
+const QuerySnapshot *query_acquire(QueryIndex *index);
+
+/**
+ * Gives a snapshot back, once done querying it.
+ *
+ * @param index The index
+ * @param snapshot What query_acquire() returned
+ */
+void query_release(QueryIndex *index, const QuerySnapshot *snapshot);
+
+/**
+ * Finds the asteroids whose edges are closest to a point.
+ *
+ * @param snapshot The snapshot
+ * @param x X position of the point
+ * @param y Y position of the point
+ * @param k Number of asteroids to find
+ * @param hits Where to put them, room for k, closest first
+ * @return Number of asteroids found, less than k only if there are less
+ */
+int query_nearest(const QuerySnapshot *snapshot, Real x, Real y, int k, QueryHit *hits);
+
+/**
+ * Finds the asteroids that touch a circle.
+ *
+ * @param snapshot The snapshot
+ * @param x X position of the center of the circle
+ * @param y Y position of the center of the circle
+ * @param radius Radius of the circle
+ * @param max Number of asteroids that fit in hits
+ * @param hits Where to put them, in cell order
+ * @return Number of asteroids touching the circle, even past max
+ */
+int query_radius(const QuerySnapshot *snapshot, Real x, Real y, Real radius, int max,
+				 QueryHit *hits);
+
+/**
+ * Finds the first asteroid along a ray.
+ *
+ * @param snapshot The snapshot
+ * @param x X position of the start of the ray
+ * @param y Y position of the start of the ray
+ * @param dx X of the direction of the ray, of length 1
+ * @param dy Y of the direction of the ray
+ * @param length Length of the ray
+ * @param hit Where to put the asteroid, its distance being where along the ray it is hit
+ * @return True if an asteroid is hit, false otherwise
+ */
+bool query_ray(const QuerySnapshot *snapshot, Real x, Real y, Real dx, Real dy, Real length,
+			   QueryHit *hit);
+
+#endif	// !QUERY_H
@@ -0,0 +1,145 @@
+#ifndef REAL_H
+#define REAL_H
+
+#include <SDL3/SDL_stdinc.h>
+
+/**
+ * The numbers the simulation runs on: positions, velocities and radii of the ship, the asteroids
+ * and the bullets, and the collision responses computed from them.
+ *
+ * They are floats by default. Built with -DFIXED_POINT (make FIXED=1) they are fixed point
+ * integers instead, with an integer square root and a table of sines, so that the same inputs give
+ * the same game bit for bit whatever the compiler, its flags or the CPU. Floats only come back to
+ * draw, and to send snapshots over the network.
+ *
+ * Arithmetic goes through the macros below wherever the two differ, and is written the same way in
+ * both, so that the float build plays exactly as it did before.
+ */
+
+#ifdef FIXED_POINT
+
+/**
+ * @brief Fractional bits. Positions go up to 2^18 pixels, velocities are 1/4096th of a pixel.
+ */
+#define REAL_SHIFT 12
+/**
+ * @brief 1 as a Real
+ */
+#define REAL_ONE (1 << REAL_SHIFT)
+
+/**
+ * A fixed point number, REAL_SHIFT bits of it fractional.
+ */
+typedef Sint32 Real;
+/**
+ * A product of two Reals, with twice as many fractional bits, for squared distances.
+ */
+typedef Sint64 RealWide;
+
+/**
+ * Sines of every degree from 0 to 90.
+ */
+extern const Real real_sines[91];
+
+/**
+ * @brief Converts an integer or a float to a Real, towards zero
+ */
+#define REAL(x) ((Real)((x) * REAL_ONE))
+/**
+ * @brief Converts a Real to a float, to draw it
+ */
+#define REAL_FLOAT(r) ((float)(r) / REAL_ONE)
+/**
+ * @brief Product of two Reals
+ */
+#define REAL_MUL(a, b) ((Real)(((Sint64)(a) * (b)) >> REAL_SHIFT))
+/**
+ * @brief Quotient of two Reals
+ */
+#define REAL_DIV(a, b) ((Real)((Sint64)(a) * REAL_ONE / (b)))
+/**
+ * @brief Quotient of two integers, as a Real
+ */
+#define REAL_RATIO(n, d) ((Real)((Sint64)(n) * REAL_ONE / (Sint64)(d)))
+
+/**
+ * Square root, rounded down, bit by bit.
+ *
+ * @param value A squared Real, as a RealWide
+ * @return Its square root, as a Real
+ */
+static inline Real real_sqrt(RealWide value)
+{
+	Uint64 rest = value;
+	Uint64 root = 0;
+	Uint64 bit = (Uint64)1 << 62;
+
+	if (value <= 0) {
+		return 0;
+	}
+	while (bit > rest) {
+		bit >>= 2;
+	}
+	while (bit) {
+		if (rest >= root + bit) {
+			rest -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return (Real)root;
+}
+
+/**
+ * Sine of a whole number of degrees.
+ *
+ * @param degrees The angle, 0 or more
+ * @return Its sine
+ */
+static inline Real real_sin(unsigned int degrees)
+{
+	degrees %= 360;
+	if (degrees <= 90) {
+		return real_sines[degrees];
+	}
+	if (degrees <= 180) {
+		return real_sines[180 - degrees];
+	}
+	if (degrees <= 270) {
+		return -real_sines[degrees - 180];
+	}
+	return -real_sines[360 - degrees];
+}
+
+/**
+ * Cosine of a whole number of degrees.
+ *
+ * @param degrees The angle, 0 or more
+ * @return Its cosine
+ */
+static inline Real real_cos(unsigned int degrees)
+{
+	return real_sin(degrees + 90);
+}
+
+#else
+
+typedef float Real;
+typedef float RealWide;
+
+#define REAL(x) ((float)(x))
+#define REAL_FLOAT(r) (r)
+#define REAL_MUL(a, b) ((a) * (b))
+#define REAL_DIV(a, b) ((a) / (b))
+#define REAL_RATIO(n, d) ((float)(n) / (d))
+#define real_sqrt(value) SDL_sqrtf(value)
+/* In double, as they always were */
+#define real_sin(degrees) SDL_sin((degrees) * SDL_PI_D / 180.0)
+#define real_cos(degrees) SDL_cos((degrees) * SDL_PI_D / 180.0)
+
+#endif	// FIXED_POINT
+
+#endif	// !REAL_H
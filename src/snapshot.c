@@ -0,0 +1,495 @@
+#include "snapshot.h"
+
+#include <SDL3/SDL_stdinc.h>
+
+/**
+ * @brief Bits of the shorter difference code, after its 2 bit prefix
+ */
+#define DELTA_SHORT_BITS 4
+/**
+ * @brief Bits of the longer difference code, after its 3 bit prefix
+ */
+#define DELTA_LONG_BITS 8
+/**
+ * @brief Bits of an entity count
+ */
+#define COUNT_BITS 16
+/**
+ * @brief Most entities of one kind in a snapshot
+ */
+#define MAX_ENTITIES SDL_max(ASTEROID_CAPACITY, MAX_BULLETS)
+
+void bits_writer_init(BitWriter *bits, Uint8 *data, int size)
+{
+	SDL_zerop(bits);
+	bits->data = data;
+	bits->size = size;
+}
+
+void bits_write(BitWriter *bits, Uint32 value, int n)
+{
+	bits->pending = (bits->pending << n) | (value & (0xFFFFFFFFu >> (32 - n)));
+	bits->n_pending += n;
+	while (bits->n_pending >= 8) {
+		bits->n_pending -= 8;
+		if (bits->bytes < bits->size) {
+			bits->data[bits->bytes++] = (Uint8)(bits->pending >> bits->n_pending);
+		} else {
+			bits->overflow = true;
+		}
+	}
+}
+
+int bits_flush(BitWriter *bits)
+{
+	if (bits->n_pending > 0) {
+		bits_write(bits, 0, 8 - bits->n_pending);
+	}
+	return bits->overflow ? -1 : bits->bytes;
+}
+
+void bits_reader_init(BitReader *bits, const Uint8 *data, int size)
+{
+	SDL_zerop(bits);
+	bits->data = data;
+	bits->size = size;
+}
+
+Uint32 bits_read(BitReader *bits, int n)
+{
+	while (bits->n_pending < n) {
+		bits->pending <<= 8;
+		if (bits->bytes < bits->size) {
+			bits->pending |= bits->data[bits->bytes++];
+		} else {
+			bits->overflow = true;
+		}
+		bits->n_pending += 8;
+	}
+	bits->n_pending -= n;
+	return (Uint32)(bits->pending >> bits->n_pending) & (0xFFFFFFFFu >> (32 - n));
+}
+
+/**
+ * Maps small negative and positive values to small unsigned ones: 0, -1, 1, -2, 2...
+ */
+static inline Uint32 zigzag(Sint32 value)
+{
+	return ((Uint32)value << 1) ^ (Uint32)(value >> 31);
+}
+
+/**
+ * Inverse of zigzag().
+ */
+static inline Sint32 unzigzag(Uint32 value)
+{
+	return (Sint32)((value >> 1) ^ (0u - (value & 1)));
+}
+
+/**
+ * Writes a difference in as few bits as it fits: 1 bit if it is 0, then two longer codes, then
+ * the full width of the field plus its sign.
+ */
+static void write_delta(BitWriter *bits, Sint32 delta, int width)
+{
+	Uint32 value = zigzag(delta);
+
+	if (value == 0) {
+		bits_write(bits, 0x0, 1);
+	} else if (value < (1u << DELTA_SHORT_BITS)) {
+		bits_write(bits, 0x2, 2);
+		bits_write(bits, value, DELTA_SHORT_BITS);
+	} else if (value < (1u << DELTA_LONG_BITS)) {
+		bits_write(bits, 0x6, 3);
+		bits_write(bits, value, DELTA_LONG_BITS);
+	} else {
+		bits_write(bits, 0x7, 3);
+		bits_write(bits, value, width + 1);
+	}
+}
+
+/**
+ * Reads a difference written by write_delta().
+ */
+static Sint32 read_delta(BitReader *bits, int width)
+{
+	if (!bits_read(bits, 1)) {
+		return 0;
+	}
+	if (!bits_read(bits, 1)) {
+		return unzigzag(bits_read(bits, DELTA_SHORT_BITS));
+	}
+	if (!bits_read(bits, 1)) {
+		return unzigzag(bits_read(bits, DELTA_LONG_BITS));
+	}
+	return unzigzag(bits_read(bits, width + 1));
+}
+
+/**
+ * Converts a value to fixed point, clamped to what fits in a field.
+ */
+static Sint32 quantize(float value, int scale, int width)
+{
+	long limit = 1L << (width - 1);
+	long steps = SDL_lroundf(value * scale);
+
+	return (Sint32)SDL_clamp(steps, -limit, limit - 1);
+}
+
+/**
+ * Where an entity would be after some ticks if it kept its velocity. Computed on the quantized
+ * values, so that both ends get the same.
+ */
+static void predict(const SnapshotEntity *entity, Uint32 elapsed, Sint32 *x, Sint32 *y)
+{
+	Sint64 ratio = SNAPSHOT_VELOCITY_SCALE / SNAPSHOT_POSITION_SCALE;
+
+	*x = (Sint32)(entity->x + (Sint64)entity->dx * elapsed / ratio);
+	*y = (Sint32)(entity->y + (Sint64)entity->dy * elapsed / ratio);
+}
+
+/**
+ * Writes an entity that is also in the baseline.
+ */
+static void write_entity(BitWriter *bits, const SnapshotEntity *entity,
+						 const SnapshotEntity *base, Uint32 elapsed, bool radius)
+{
+	Sint32 x, y;
+
+	predict(base, elapsed, &x, &y);
+	if (entity->x == x && entity->y == y && entity->dx == base->dx && entity->dy == base->dy
+		&& entity->radius == base->radius) {
+		bits_write(bits, 0, 1);
+		return;
+	}
+
+	bits_write(bits, 1, 1);
+	write_delta(bits, entity->x - x, SNAPSHOT_POSITION_BITS);
+	write_delta(bits, entity->y - y, SNAPSHOT_POSITION_BITS);
+	write_delta(bits, entity->dx - base->dx, SNAPSHOT_VELOCITY_BITS);
+	write_delta(bits, entity->dy - base->dy, SNAPSHOT_VELOCITY_BITS);
+	if (radius) {
+		write_delta(bits, entity->radius - base->radius, SNAPSHOT_RADIUS_BITS);
+	}
+}
+
+/**
+ * Reads an entity written by write_entity().
+ */
+static void read_entity(BitReader *bits, SnapshotEntity *entity, const SnapshotEntity *base,
+						Uint32 elapsed, bool radius)
+{
+	Sint32 x, y;
+
+	predict(base, elapsed, &x, &y);
+	*entity = *base;
+	entity->x = x;
+	entity->y = y;
+	if (!bits_read(bits, 1)) {
+		return;
+	}
+
+	entity->x += read_delta(bits, SNAPSHOT_POSITION_BITS);
+	entity->y += read_delta(bits, SNAPSHOT_POSITION_BITS);
+	entity->dx += read_delta(bits, SNAPSHOT_VELOCITY_BITS);
+	entity->dy += read_delta(bits, SNAPSHOT_VELOCITY_BITS);
+	if (radius) {
+		entity->radius += read_delta(bits, SNAPSHOT_RADIUS_BITS);
+	}
+}
+
+/**
+ * Writes an entity that isn't in the baseline.
+ */
+static void write_new_entity(BitWriter *bits, const SnapshotEntity *entity, bool radius)
+{
+	bits_write(bits, entity->handle, 32);
+	bits_write(bits, zigzag(entity->x), SNAPSHOT_POSITION_BITS);
+	bits_write(bits, zigzag(entity->y), SNAPSHOT_POSITION_BITS);
+	bits_write(bits, zigzag(entity->dx), SNAPSHOT_VELOCITY_BITS);
+	bits_write(bits, zigzag(entity->dy), SNAPSHOT_VELOCITY_BITS);
+	if (radius) {
+		bits_write(bits, zigzag(entity->radius), SNAPSHOT_RADIUS_BITS);
+	}
+}
+
+/**
+ * Reads an entity written by write_new_entity().
+ */
+static void read_new_entity(BitReader *bits, SnapshotEntity *entity, bool radius)
+{
+	entity->handle = bits_read(bits, 32);
+	entity->x = unzigzag(bits_read(bits, SNAPSHOT_POSITION_BITS));
+	entity->y = unzigzag(bits_read(bits, SNAPSHOT_POSITION_BITS));
+	entity->dx = unzigzag(bits_read(bits, SNAPSHOT_VELOCITY_BITS));
+	entity->dy = unzigzag(bits_read(bits, SNAPSHOT_VELOCITY_BITS));
+	entity->radius = radius ? unzigzag(bits_read(bits, SNAPSHOT_RADIUS_BITS)) : 0;
+}
+
+/**
+ * Writes a list of entities against the same list in the baseline. First, in baseline order,
+ * whether each baseline entity is still there and how it changed. Then the new ones in full.
+ */
+static void write_entities(BitWriter *bits, const SnapshotEntity *entities, int n,
+						   const SnapshotEntity *base, int n_base, Uint32 elapsed, bool radius)
+{
+	int added[MAX_ENTITIES];
+	int n_added = 0;
+	int i = 0;
+
+	for (int b = 0; b < n_base; b++) {
+		while (i < n && entities[i].handle < base[b].handle) {
+			added[n_added++] = i++;
+		}
+		if (i < n && entities[i].handle == base[b].handle) {
+			bits_write(bits, 1, 1);
+			write_entity(bits, &entities[i++], &base[b], elapsed, radius);
+		} else {
+			bits_write(bits, 0, 1);
+		}
+	}
+	while (i < n) {
+		added[n_added++] = i++;
+	}
+
+	bits_write(bits, n_added, COUNT_BITS);
+	for (int a = 0; a < n_added; a++) {
+		write_new_entity(bits, &entities[added[a]], radius);
+	}
+}
+
+/**
+ * Reads a list of entities written by write_entities(), and merges the kept and new ones back
+ * into handle order.
+ */
+static bool read_entities(BitReader *bits, SnapshotEntity *entities, int *n, int capacity,
+						  const SnapshotEntity *base, int n_base, Uint32 elapsed, bool radius)
+{
+	SnapshotEntity kept[MAX_ENTITIES];
+	SnapshotEntity added[MAX_ENTITIES];
+	int n_kept = 0, n_added, k = 0, a = 0;
+
+	for (int b = 0; b < n_base; b++) {
+		if (bits_read(bits, 1)) {
+			read_entity(bits, &kept[n_kept++], &base[b], elapsed, radius);
+		}
+	}
+	n_added = bits_read(bits, COUNT_BITS);
+	if (bits->overflow || n_kept + n_added > capacity) {
+		return false;
+	}
+	for (int i = 0; i < n_added; i++) {
+		read_new_entity(bits, &added[i], radius);
+	}
+
+	*n = n_kept + n_added;
+	for (int i = 0; i < *n; i++) {
+		if (a == n_added || (k < n_kept && kept[k].handle < added[a].handle)) {
+			entities[i] = kept[k++];
+		} else {
+			entities[i] = added[a++];
+		}
+		/* Handles are unique and sorted, anything else is garbage */
+		if (i > 0 && entities[i].handle <= entities[i - 1].handle) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Orders entities by handle, for SDL_qsort().
+ */
+static int compare_handles(const void *a, const void *b)
+{
+	Handle first = ((const SnapshotEntity *)a)->handle;
+	Handle second = ((const SnapshotEntity *)b)->handle;
+
+	return (first > second) - (first < second);
+}
+
+void snapshot_capture(Snapshot *snapshot, Game *game, Uint32 tick)
+{
+	Player *player = game->player;
+	Bullet *bullets = game->bullets.items;
+
+	snapshot->tick = tick;
+	snapshot->state = game->state;
+	snapshot->level = game->level;
+	snapshot->x = quantize(REAL_FLOAT(player->x), SNAPSHOT_POSITION_SCALE, SNAPSHOT_POSITION_BITS);
+	snapshot->y = quantize(REAL_FLOAT(player->y), SNAPSHOT_POSITION_SCALE, SNAPSHOT_POSITION_BITS);
+	snapshot->velocity
+	  = quantize(REAL_FLOAT(player->velocity), SNAPSHOT_VELOCITY_SCALE, SNAPSHOT_VELOCITY_BITS);
+	snapshot->direction = player->direction % 360;
+
+	snapshot->n_asteroids = game->asteroids.count;
+	for (int i = 0; i < game->asteroids.count; i++) {
+		Asteroid unpacked = asteroid_get(game, i);
+		Asteroid *asteroid = &unpacked;
+		snapshot->asteroids[i] = (SnapshotEntity){
+			.handle = game->asteroids.handles[i],
+			.x = quantize(REAL_FLOAT(asteroid->x), SNAPSHOT_POSITION_SCALE, SNAPSHOT_POSITION_BITS),
+			.y = quantize(REAL_FLOAT(asteroid->y), SNAPSHOT_POSITION_SCALE, SNAPSHOT_POSITION_BITS),
+			.dx = quantize(REAL_FLOAT(asteroid->dx), SNAPSHOT_VELOCITY_SCALE,
+						   SNAPSHOT_VELOCITY_BITS),
+			.dy = quantize(REAL_FLOAT(asteroid->dy), SNAPSHOT_VELOCITY_SCALE,
+						   SNAPSHOT_VELOCITY_BITS),
+			.radius = quantize(REAL_FLOAT(asteroid->radius), SNAPSHOT_RADIUS_SCALE,
+							   SNAPSHOT_RADIUS_BITS),
+		};
+	}
+	snapshot->n_bullets = game->bullets.count;
+	for (int i = 0; i < game->bullets.count; i++) {
+		Bullet *bullet = &bullets[i];
+		snapshot->bullets[i] = (SnapshotEntity){
+			.handle = game->bullets.handles[i],
+			.x = quantize(REAL_FLOAT(bullet->x), SNAPSHOT_POSITION_SCALE, SNAPSHOT_POSITION_BITS),
+			.y = quantize(REAL_FLOAT(bullet->y), SNAPSHOT_POSITION_SCALE, SNAPSHOT_POSITION_BITS),
+			.dx = quantize(REAL_FLOAT(bullet->dx), SNAPSHOT_VELOCITY_SCALE, SNAPSHOT_VELOCITY_BITS),
+			.dy = quantize(REAL_FLOAT(bullet->dy), SNAPSHOT_VELOCITY_SCALE, SNAPSHOT_VELOCITY_BITS),
+		};
+	}
+
+	/* Stores reuse slots, so dense order isn't handle order */
+	SDL_qsort(snapshot->asteroids, snapshot->n_asteroids, sizeof(SnapshotEntity),
+			  compare_handles);
+	SDL_qsort(snapshot->bullets, snapshot->n_bullets, sizeof(SnapshotEntity), compare_handles);
+}
+
+void snapshot_write(BitWriter *bits, const Snapshot *snapshot, const Snapshot *baseline)
+{
+	Uint32 elapsed = snapshot->tick - baseline->tick;
+
+	bits_write(bits, snapshot->state, 2);
+	bits_write(bits, snapshot->level, 16);
+	write_delta(bits, snapshot->x - baseline->x, SNAPSHOT_POSITION_BITS);
+	write_delta(bits, snapshot->y - baseline->y, SNAPSHOT_POSITION_BITS);
+	write_delta(bits, snapshot->velocity - baseline->velocity, SNAPSHOT_VELOCITY_BITS);
+	write_delta(bits, snapshot->direction - baseline->direction, SNAPSHOT_DIRECTION_BITS);
+
+	write_entities(bits, snapshot->asteroids, snapshot->n_asteroids, baseline->asteroids,
+				   baseline->n_asteroids, elapsed, true);
+	write_entities(bits, snapshot->bullets, snapshot->n_bullets, baseline->bullets,
+				   baseline->n_bullets, elapsed, false);
+}
+
+bool snapshot_read(BitReader *bits, Snapshot *snapshot, const Snapshot *baseline)
+{
+	Uint32 elapsed = snapshot->tick - baseline->tick;
+
+	snapshot->state = bits_read(bits, 2);
+	snapshot->level = bits_read(bits, 16);
+	snapshot->x = baseline->x + read_delta(bits, SNAPSHOT_POSITION_BITS);
+	snapshot->y = baseline->y + read_delta(bits, SNAPSHOT_POSITION_BITS);
+	snapshot->velocity = baseline->velocity + read_delta(bits, SNAPSHOT_VELOCITY_BITS);
+	snapshot->direction = baseline->direction + read_delta(bits, SNAPSHOT_DIRECTION_BITS);
+
+	if (!read_entities(bits, snapshot->asteroids, &snapshot->n_asteroids, ASTEROID_CAPACITY,
+					   baseline->asteroids, baseline->n_asteroids, elapsed, true)
+		|| !read_entities(bits, snapshot->bullets, &snapshot->n_bullets, MAX_BULLETS,
+						  baseline->bullets, baseline->n_bullets, elapsed, false)) {
+		return false;
+	}
+	return !bits->overflow && snapshot->direction >= 0 && snapshot->direction < 360;
+}
+
+/**
+ * Pairs up the entities of two snapshots by handle. Entities only in one of them are paired with
+ * themselves, and only kept if that snapshot is the nearest one.
+ *
+ * @return Number of pairs. The two entities of each are next to each other in pairs.
+ */
+static int pair_entities(const SnapshotEntity **pairs, const SnapshotEntity *from, int n_from,
+						 const SnapshotEntity *to, int n_to, float t)
+{
+	int f = 0, n = 0;
+
+	for (int i = 0; i < n_to; i++) {
+		while (f < n_from && from[f].handle < to[i].handle) {
+			if (t < 0.5f) {
+				pairs[2 * n] = pairs[2 * n + 1] = &from[f];
+				n++;
+			}
+			f++;
+		}
+		if (f < n_from && from[f].handle == to[i].handle) {
+			pairs[2 * n] = &from[f++];
+			pairs[2 * n + 1] = &to[i];
+			n++;
+		} else if (t >= 0.5f) {
+			pairs[2 * n] = pairs[2 * n + 1] = &to[i];
+			n++;
+		}
+	}
+	for (; f < n_from && t < 0.5f; f++) {
+		pairs[2 * n] = pairs[2 * n + 1] = &from[f];
+		n++;
+	}
+	return n;
+}
+
+/**
+ * Value between two quantized ones, back in pixels.
+ */
+static inline Real lerp(Sint32 from, Sint32 to, float t, int scale)
+{
+	return REAL((from + (to - from) * t) / scale);
+}
+
+void snapshot_load(Game *game, const Snapshot *from, const Snapshot *to, float t)
+{
+	const SnapshotEntity *pairs[2 * (ASTEROID_CAPACITY + MAX_BULLETS)];
+	Player *player = game->player;
+	const Snapshot *nearest;
+	int n, turn;
+
+	if (!to) {
+		to = from;
+		t = 0;
+	}
+	nearest = (t < 0.5f) ? from : to;
+
+	game->state = nearest->state;
+	game->level = nearest->level;
+	player->x = lerp(from->x, to->x, t, SNAPSHOT_POSITION_SCALE);
+	player->y = lerp(from->y, to->y, t, SNAPSHOT_POSITION_SCALE);
+	player->velocity = lerp(from->velocity, to->velocity, t, SNAPSHOT_VELOCITY_SCALE);
+	/* The short way around */
+	turn = to->direction - from->direction;
+	if (turn > 180) {
+		turn -= 360;
+	} else if (turn < -180) {
+		turn += 360;
+	}
+	player->direction = (from->direction + (int)SDL_lroundf(turn * t) + 360) % 360;
+
+	store_clear(&game->asteroids);
+	n = pair_entities(pairs, from->asteroids, from->n_asteroids, to->asteroids, to->n_asteroids,
+					  t);
+	for (int i = 0; i < n; i++) {
+		const SnapshotEntity *a = pairs[2 * i], *b = pairs[2 * i + 1];
+		Asteroid asteroid = {
+			.x = lerp(a->x, b->x, t, SNAPSHOT_POSITION_SCALE),
+			.y = lerp(a->y, b->y, t, SNAPSHOT_POSITION_SCALE),
+			.radius = lerp(a->radius, b->radius, t, SNAPSHOT_RADIUS_SCALE),
+			.dx = lerp(a->dx, b->dx, t, SNAPSHOT_VELOCITY_SCALE),
+			.dy = lerp(a->dy, b->dy, t, SNAPSHOT_VELOCITY_SCALE),
+		};
+		asteroid_create(game, &asteroid);
+	}
+	store_commit(&game->asteroids);
+
+	store_clear(&game->bullets);
+	n = pair_entities(pairs, from->bullets, from->n_bullets, to->bullets, to->n_bullets, t);
+	for (int i = 0; i < n; i++) {
+		const SnapshotEntity *a = pairs[2 * i], *b = pairs[2 * i + 1];
+		Bullet bullet = {
+			.x = lerp(a->x, b->x, t, SNAPSHOT_POSITION_SCALE),
+			.y = lerp(a->y, b->y, t, SNAPSHOT_POSITION_SCALE),
+			.dx = lerp(a->dx, b->dx, t, SNAPSHOT_VELOCITY_SCALE),
+			.dy = lerp(a->dy, b->dy, t, SNAPSHOT_VELOCITY_SCALE),
+		};
+		store_create(&game->bullets, &bullet);
+	}
+	store_commit(&game->bullets);
+}
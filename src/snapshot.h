@@ -0,0 +1,190 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+
+#include <SDL3/SDL_stdinc.h>
+
+#include "config.h"
+#include "game.h"
+#include "store.h"
+
+/**
+ * Quantized copies of the game state, and their bit-packed encoding against an older one.
+ *
+ * Positions, velocities and radii are stored as fixed point integers, so that the sender and the
+ * receiver predict and reconstruct them exactly the same way. Entities are identified by their
+ * store handle and kept sorted by it, so two snapshots are compared in one pass.
+ *
+ * Against a baseline, an entity costs one bit if it is gone, and one more if it moved exactly as
+ * its velocity predicts. Otherwise every field is sent as its difference from the prediction, in
+ * as few bits as it fits. Entities missing from the baseline are sent in full. Encoding against an
+ * empty snapshot sends everything in full.
+ */
+
+/**
+ * @brief Steps per pixel of positions
+ */
+#define SNAPSHOT_POSITION_SCALE 8
+/**
+ * @brief Steps per pixel per frame of velocities
+ */
+#define SNAPSHOT_VELOCITY_SCALE 64
+/**
+ * @brief Steps per pixel of radii
+ */
+#define SNAPSHOT_RADIUS_SCALE 16
+/**
+ * @brief Bits of a position sent in full, enough for worlds up to 4096 pixels wide
+ */
+#define SNAPSHOT_POSITION_BITS 16
+/**
+ * @brief Bits of a velocity sent in full, enough for 32 pixels per frame
+ */
+#define SNAPSHOT_VELOCITY_BITS 12
+/**
+ * @brief Bits of a radius sent in full
+ */
+#define SNAPSHOT_RADIUS_BITS 10
+/**
+ * @brief Bits of the direction of the ship sent in full
+ */
+#define SNAPSHOT_DIRECTION_BITS 10
+
+/**
+ * Writes values of any number of bits, up to 32, one after another into a byte buffer.
+ */
+typedef struct {
+	Uint8* data;	/**< Buffer the bits go to */
+	int size;		/**< Size of the buffer, in bytes */
+	int bytes;		/**< Whole bytes written */
+	Uint64 pending;	/**< Bits that don't make a whole byte yet, in the lowest n_pending bits */
+	int n_pending;	/**< Number of pending bits */
+	bool overflow;	/**< Whether the buffer was too small */
+} BitWriter;
+
+/**
+ * Reads back values written by a BitWriter.
+ */
+typedef struct {
+	const Uint8* data; /**< Buffer the bits come from */
+	int size;		   /**< Size of the buffer, in bytes */
+	int bytes;		   /**< Whole bytes read */
+	Uint64 pending;	   /**< Bits read from the buffer but not returned yet */
+	int n_pending;	   /**< Number of pending bits */
+	bool overflow;	   /**< Whether more bits were read than the buffer has */
+} BitReader;
+
+/**
+ * An asteroid or a bullet, quantized.
+ */
+typedef struct {
+	Handle handle; /**< Handle of the entity in its store */
+	Sint32 x;	   /**< X position, in SNAPSHOT_POSITION_SCALE steps */
+	Sint32 y;	   /**< Y position */
+	Sint32 dx;	   /**< X velocity, in SNAPSHOT_VELOCITY_SCALE steps */
+	Sint32 dy;	   /**< Y velocity */
+	Sint32 radius; /**< Radius, in SNAPSHOT_RADIUS_SCALE steps. 0 for bullets. */
+} SnapshotEntity;
+
+/**
+ * What the game looks like at the end of a tick, quantized.
+ */
+typedef struct {
+	Uint32 tick;								 /**< Tick it was taken at, 0 if empty */
+	GameState state;							 /**< State of the game */
+	unsigned int level;							 /**< Current level */
+	Sint32 x;									 /**< X position of the ship */
+	Sint32 y;									 /**< Y position of the ship */
+	Sint32 velocity;							 /**< Velocity of the ship */
+	Sint32 direction;							 /**< Direction of the ship, 0-359 */
+	int n_asteroids;							 /**< Number of asteroids */
+	int n_bullets;								 /**< Number of bullets */
+	SnapshotEntity asteroids[ASTEROID_CAPACITY]; /**< Asteroids, sorted by handle */
+	SnapshotEntity bullets[MAX_BULLETS];		 /**< Bullets, sorted by handle */
+} Snapshot;
+
+/**
+ * Starts writing bits into a buffer.
+ *
+ * @param bits The writer
+ * @param data Buffer to write to
+ * @param size Size of the buffer, in bytes
+ */
+void bits_writer_init(BitWriter *bits, Uint8 *data, int size);
+
+/**
+ * Writes the lowest bits of a value.
+ *
+ * @param bits The writer
+ * @param value Value to write
+ * @param n Number of bits, 1 to 32
+ */
+void bits_write(BitWriter *bits, Uint32 value, int n);
+
+/**
+ * Writes the pending bits, padded with zeros to a whole byte.
+ *
+ * @param bits The writer
+ * @return Bytes written, -1 if they didn't fit
+ */
+int bits_flush(BitWriter *bits);
+
+/**
+ * Starts reading bits from a buffer.
+ *
+ * @param bits The reader
+ * @param data Buffer to read from
+ * @param size Size of the buffer, in bytes
+ */
+void bits_reader_init(BitReader *bits, const Uint8 *data, int size);
+
+/**
+ * Reads a value.
+ *
+ * @param bits The reader
+ * @param n Number of bits, 1 to 32
+ * @return The value, 0 past the end of the buffer
+ */
+Uint32 bits_read(BitReader *bits, int n);
+
+/**
+ * Takes a snapshot of the game. Must be called between frames.
+ *
+ * @param snapshot Snapshot to fill
+ * @param game Game to take it of
+ * @param tick Tick to stamp it with, not 0
+ */
+void snapshot_capture(Snapshot *snapshot, Game *game, Uint32 tick);
+
+/**
+ * Encodes a snapshot against an older one the receiver has. Its tick isn't encoded.
+ *
+ * @param bits Where to write it
+ * @param snapshot Snapshot to encode
+ * @param baseline Snapshot to encode against, or an empty one
+ */
+void snapshot_write(BitWriter *bits, const Snapshot *snapshot, const Snapshot *baseline);
+
+/**
+ * Decodes a snapshot written by snapshot_write().
+ *
+ * @param bits Where to read it from
+ * @param snapshot Snapshot to fill. Its tick must already be set.
+ * @param baseline The same snapshot it was encoded against
+ * @return True if it was decoded, false if the data is truncated or invalid
+ */
+bool snapshot_read(BitReader *bits, Snapshot *snapshot, const Snapshot *baseline);
+
+/**
+ * Loads the state between two snapshots into a game, to draw it. Entities in both are
+ * interpolated, the rest show up or go away halfway.
+ *
+ * @param game Game to load into. Only meant to be drawn, never updated.
+ * @param from Older snapshot
+ * @param to Newer snapshot, or NULL to load from as it is
+ * @param t Fraction of the way from one to the other, 0 to 1
+ */
+void snapshot_load(Game *game, const Snapshot *from, const Snapshot *to, float t);
+
+#endif	// !SNAPSHOT_H
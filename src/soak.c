@@ -0,0 +1,669 @@
+#include "soak.h"
+#include <stdlib.h>
+
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_timer.h>
+
+#include "config.h"
+#include "game.h"
+#include "jobs.h"
+#include "query.h"
+#include "stats.h"
+#include "telemetry.h"
+
+/**
+ * Ticks between two throughput reports
+ */
+#define SOAK_REPORT_INTERVAL 1000000
+/**
+ * One in this many ticks the window gets resized
+ */
+#define SOAK_RESIZE_CHANCE 500
+
+/**
+ * Asteroids the soak test looks for around the ship
+ */
+#define SOAK_QUERY_NEAREST 4
+/**
+ * Radius around the ship the soak test looks in, and length of the ray along its heading
+ */
+#define SOAK_QUERY_REACH 400
+/**
+ * Events the soak test reads at a time
+ */
+#define SOAK_EVENTS 256
+/**
+ * Queries timed by the benchmark
+ */
+#define BENCH_QUERIES 300000
+/**
+ * Queries per job of the benchmark
+ */
+#define BENCH_QUERIES_PER_JOB 1000
+
+/**
+ * Description of the last violated invariant
+ */
+static char violation[128];
+
+/**
+ * Feeds the game one tick worth of random input, the same way SDL_AppEvent would.
+ *
+ * @param game The game to drive
+ * @param rng State of the input generator
+ */
+static void soak_input(Game *game, Uint64 *rng)
+{
+	Uint64 frame_ns = SDL_NS_PER_SECOND / FPS;
+	/* Inputs happen during the frame before the one being simulated */
+	Uint64 timestamp = game->time - frame_ns + SDL_rand_r(rng, (Sint32)frame_ns);
+	InputAction action;
+
+	if (game->state != PLAY) {
+		/* Any key leaves the menu, the pause and the game over screens */
+		if (SDL_rand_r(rng, 8) == 0) {
+			if (game->state == GAME_OVER)
+				game_reset(game);
+			game->state = PLAY;
+		}
+		return;
+	}
+
+	switch (SDL_rand_r(rng, 16)) {
+	case 0:
+		game_input(game, INPUT_LEFT, true, timestamp);
+		break;
+	case 1:
+		game_input(game, INPUT_RIGHT, true, timestamp);
+		break;
+	case 2:
+		game_input(game, SDL_rand_r(rng, 2) ? INPUT_LEFT : INPUT_RIGHT, false, timestamp);
+		break;
+	case 3:
+		game_input(game, INPUT_THRUST, true, timestamp);
+		break;
+	case 4:
+		game_input(game, INPUT_BRAKE, true, timestamp);
+		break;
+	case 5:
+		game_input(game, SDL_rand_r(rng, 2) ? INPUT_THRUST : INPUT_BRAKE, false, timestamp);
+		break;
+	case 6:
+	case 7:
+		game_input(game, INPUT_FIRE, true, timestamp);
+		break;
+	case 8:
+		/* A tap, pressed and released within the frame */
+		action = INPUT_LEFT + SDL_rand_r(rng, 4);
+		game_input(game, action, true, timestamp);
+		game_input(game, action, false, timestamp);
+		break;
+	case 9:
+		if (SDL_rand_r(rng, 64) == 0)
+			game->state = PAUSE;
+		break;
+	case 10:
+		/* The quality governor can switch this at any time */
+		if (SDL_rand_r(rng, 64) == 0)
+			game->cheap_collisions = !game->cheap_collisions;
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Resizes the window to a random size, the same way SDL_AppEvent would.
+ *
+ * @param game The game to resize
+ * @param rng State of the input generator
+ */
+static void soak_resize(Game *game, Uint64 *rng)
+{
+	game->width = MIN_WIDTH + SDL_rand_r(rng, 4 * WIDTH - MIN_WIDTH);
+	game->height = MIN_HEIGHT + SDL_rand_r(rng, 4 * HEIGHT - MIN_HEIGHT);
+	game_resize(game);
+}
+
+/**
+ * Checks whether a point is finite and inside the world.
+ */
+static bool soak_in_bounds(Game *game, float x, float y)
+{
+	if (!SDL_isinf(x) && !SDL_isnan(x) && !SDL_isinf(y) && !SDL_isnan(y)) {
+		return x >= 0 && x <= game->world_width && y >= 0 && y <= game->world_height;
+	}
+	return false;
+}
+
+/**
+ * Checks that a store is compacted, as it must be between frames, and that its handles agree
+ * with its slots.
+ *
+ * @param store The store to check
+ * @param name Name of the store, for the violation
+ * @return True if it is consistent, false otherwise. The violation is described in violation.
+ */
+static bool soak_check_store(Store *store, const char *name)
+{
+	if (store->count < 0 || store->count + store->n_free != store->capacity) {
+		SDL_snprintf(violation, sizeof(violation), "%s: %d in use, %d free of %d", name,
+					 store->count, store->n_free, store->capacity);
+		return false;
+	}
+	if (store->n_dead != 0 || store->n_created != 0) {
+		SDL_snprintf(violation, sizeof(violation), "%s: %d destroyed and %d created pending",
+					 name, store->n_dead, store->n_created);
+		return false;
+	}
+	for (int i = 0; i < store->count; i++) {
+		if (store_find(store, store->handles[i]) != i) {
+			SDL_snprintf(violation, sizeof(violation), "%s: handle %08x of %d finds %d", name,
+						 store->handles[i], i, store_find(store, store->handles[i]));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Checks every invariant of the game.
+ *
+ * @param game The game to check
+ * @return True if they all hold, false otherwise. The violation is described in violation.
+ */
+static bool soak_check(Game *game)
+{
+	Player *player = game->player;
+
+	if (!soak_check_store(&game->asteroids, "asteroids")
+		|| !soak_check_store(&game->bullets, "bullets")) {
+		return false;
+	}
+	if (game->state == PLAY && game->n_inputs != 0) {
+		/* Every tick drains the whole queue */
+		SDL_snprintf(violation, sizeof(violation), "%d inputs left queued", game->n_inputs);
+		return false;
+	}
+	if (!soak_in_bounds(game, REAL_FLOAT(player->x), REAL_FLOAT(player->y))) {
+		SDL_snprintf(violation, sizeof(violation), "player at (%f, %f)", REAL_FLOAT(player->x),
+					 REAL_FLOAT(player->y));
+		return false;
+	}
+	Bullet *bullets = game->bullets.items;
+	for (int i = 0; i < game->bullets.count; i++) {
+		Bullet *bullet = &bullets[i];
+		if (!soak_in_bounds(game, REAL_FLOAT(bullet->x), REAL_FLOAT(bullet->y))) {
+			SDL_snprintf(violation, sizeof(violation), "bullet %d at (%f, %f)", i,
+						 REAL_FLOAT(bullet->x), REAL_FLOAT(bullet->y));
+			return false;
+		}
+	}
+	for (int i = 0; i < game->asteroids.count; i++) {
+		Asteroid unpacked = asteroid_get(game, i);
+		Asteroid *asteroid = &unpacked;
+		if (!soak_in_bounds(game, REAL_FLOAT(asteroid->x), REAL_FLOAT(asteroid->y))
+			|| SDL_isnan(REAL_FLOAT(asteroid->dx)) || SDL_isnan(REAL_FLOAT(asteroid->dy))
+			|| asteroid->radius < REAL(ASTEROID_RADIUS_MIN / 2.0f)
+			|| asteroid->radius > REAL(ASTEROID_RADIUS_MAX)) {
+			SDL_snprintf(violation, sizeof(violation),
+						 "asteroid %d at (%f, %f) radius %f velocity (%f, %f)", i,
+						 REAL_FLOAT(asteroid->x), REAL_FLOAT(asteroid->y),
+						 REAL_FLOAT(asteroid->radius), REAL_FLOAT(asteroid->dx),
+						 REAL_FLOAT(asteroid->dy));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Checks the spatial queries from the ship against looking at every asteroid, with the same
+ * arithmetic so that the answers are exactly the same.
+ *
+ * @param game The game
+ * @param index The index, updated since the last tick
+ * @return True if they agree, false otherwise. The violation is described in violation.
+ */
+static bool soak_check_queries(Game *game, QueryIndex *index)
+{
+	Player *player = game->player;
+	Real dx = real_sin(player->direction);
+	Real dy = -real_cos(player->direction);
+	Real reach = REAL(SOAK_QUERY_REACH);
+	Real nearest[SOAK_QUERY_NEAREST];
+	int n_nearest = 0, n_radius = 0;
+	bool ray = false;
+	Real ray_distance = 0;
+
+	for (int i = 0; i < game->asteroids.count; i++) {
+		Asteroid unpacked = asteroid_get(game, i);
+		Asteroid *asteroid = &unpacked;
+		Real ex = asteroid->x - player->x;
+		Real ey = asteroid->y - player->y;
+		RealWide dist_sq = (RealWide)ex * ex + (RealWide)ey * ey;
+		Real distance = real_sqrt(dist_sq) - asteroid->radius;
+		Real touch = reach + asteroid->radius;
+
+		if (n_nearest < SOAK_QUERY_NEAREST || distance < nearest[n_nearest - 1]) {
+			int j = (n_nearest < SOAK_QUERY_NEAREST) ? n_nearest++ : n_nearest - 1;
+			while (j > 0 && nearest[j - 1] > distance) {
+				nearest[j] = nearest[j - 1];
+				j--;
+			}
+			nearest[j] = distance;
+		}
+		if (dist_sq <= (RealWide)touch * touch) {
+			n_radius++;
+		}
+
+		Real along = REAL_MUL(ex, dx) + REAL_MUL(ey, dy);
+		RealWide outside = dist_sq - (RealWide)asteroid->radius * asteroid->radius;
+		Real entry = 0;
+		if (outside > 0) {
+			RealWide half_chord_sq = (RealWide)along * along - outside;
+			if (along < 0 || half_chord_sq < 0) {
+				continue;
+			}
+			entry = along - real_sqrt(half_chord_sq);
+		}
+		if (entry <= reach && (!ray || entry < ray_distance)) {
+			ray = true;
+			ray_distance = entry;
+		}
+	}
+
+	const QuerySnapshot *snapshot = query_acquire(index);
+	QueryHit hits[SOAK_QUERY_NEAREST];
+	QueryHit hit;
+	bool hit_found, ok = false;
+	int found;
+
+	if (snapshot->tick != game->tick || snapshot->count != game->asteroids.count) {
+		SDL_snprintf(violation, sizeof(violation), "query: %d asteroids at tick %llu, not %d",
+					 snapshot->count, (unsigned long long)snapshot->tick,
+					 game->asteroids.count);
+	} else if ((found = query_nearest(snapshot, player->x, player->y, SOAK_QUERY_NEAREST, hits))
+			   != n_nearest) {
+		SDL_snprintf(violation, sizeof(violation), "query: %d nearest, not %d", found, n_nearest);
+	} else if ((found = query_radius(snapshot, player->x, player->y, reach, 0, NULL))
+			   != n_radius) {
+		SDL_snprintf(violation, sizeof(violation), "query: %d within %d, not %d", found,
+					 SOAK_QUERY_REACH, n_radius);
+	} else if ((hit_found = query_ray(snapshot, player->x, player->y, dx, dy, reach, &hit)) != ray
+			   || (ray && hit.distance != ray_distance)) {
+		SDL_snprintf(violation, sizeof(violation), "query: ray hits %d at %f, not %d at %f",
+					 hit_found, hit_found ? REAL_FLOAT(hit.distance) : 0.0f, ray,
+					 REAL_FLOAT(ray_distance));
+	} else {
+		ok = true;
+		for (int k = 0; k < n_nearest && ok; k++) {
+			if (hits[k].distance != nearest[k]) {
+				SDL_snprintf(violation, sizeof(violation), "query: nearest %d at %f, not %f", k,
+							 REAL_FLOAT(hits[k].distance), REAL_FLOAT(nearest[k]));
+				ok = false;
+			}
+		}
+	}
+	query_release(index, snapshot);
+
+	return ok;
+}
+
+/**
+ * Mixes a value into a checksum, FNV-1a style.
+ */
+static void soak_hash(Uint64 *hash, const void *value, size_t size)
+{
+	for (size_t i = 0; i < size; i++) {
+		*hash = (*hash ^ ((const Uint8 *)value)[i]) * 0x100000001b3ULL;
+	}
+}
+
+/**
+ * Reads the events of the last tick, if any, and checks they are about it: the tick and level are
+ * those just played, and asteroids hit are gone.
+ *
+ * @param game The game
+ * @param reader Reader of the events of the game
+ * @param ticked Whether the game ran a tick
+ * @param counts Events of each kind read so far, to add these to
+ * @return True if they are, false otherwise. The violation is described in violation.
+ */
+static bool soak_check_events(Game *game, int reader, bool ticked, Uint64 *counts)
+{
+	GameEvent events[SOAK_EVENTS];
+	int n;
+
+	while ((n = events_read(&game->events, reader, events, SOAK_EVENTS)) > 0) {
+		for (int i = 0; i < n; i++) {
+			GameEvent *event = &events[i];
+			if (!ticked || event->tick + 1 != game->tick || event->level != game->level
+				|| event->type >= EVENT_TYPES) {
+				SDL_snprintf(violation, sizeof(violation), "event %d of tick %llu level %u",
+							 event->type, (unsigned long long)event->tick, event->level);
+				return false;
+			}
+			if ((event->type == EVENT_HIT || event->type == EVENT_SPLIT
+				 || event->type == EVENT_DESTROYED)
+				&& store_find(&game->asteroids, event->handle) != -1) {
+				SDL_snprintf(violation, sizeof(violation), "event %d of asteroid %08x still alive",
+							 event->type, event->handle);
+				return false;
+			}
+			counts[event->type]++;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Checks a wave right after it spawned: no two of its asteroids overlap, and none is in the
+ * clearance around the ship. They are created at the end of the tick, so they are still where
+ * they were placed, and they are the only asteroids.
+ *
+ * @param game The game
+ * @param ship_x X position of the ship when the wave spawned, before the tick moved it
+ * @param ship_y Y position of the ship when the wave spawned
+ * @return True if they hold, false otherwise. The violation is described in violation.
+ */
+static bool soak_check_wave(Game *game, Real ship_x, Real ship_y)
+{
+	for (int i = 0; i < game->asteroids.count; i++) {
+		Asteroid asteroid = asteroid_get(game, i);
+		Real dx = asteroid.x - ship_x;
+		Real dy = asteroid.y - ship_y;
+		Real clearance = REAL(SPAWN_CLEARANCE) + asteroid.radius;
+		if ((RealWide)dx * dx + (RealWide)dy * dy < (RealWide)clearance * clearance) {
+			SDL_snprintf(violation, sizeof(violation),
+						 "asteroid %d spawned at (%f, %f), too close to the ship at (%f, %f)", i,
+						 REAL_FLOAT(asteroid.x), REAL_FLOAT(asteroid.y), REAL_FLOAT(ship_x),
+						 REAL_FLOAT(ship_y));
+			return false;
+		}
+		for (int j = 0; j < i; j++) {
+			Asteroid other = asteroid_get(game, j);
+			Real ex = other.x - asteroid.x;
+			Real ey = other.y - asteroid.y;
+			Real gap = other.radius + asteroid.radius;
+			if ((RealWide)ex * ex + (RealWide)ey * ey <= (RealWide)gap * gap) {
+				SDL_snprintf(violation, sizeof(violation),
+							 "asteroids %d and %d spawned overlapping at (%f, %f) and (%f, %f)", j,
+							 i, REAL_FLOAT(other.x), REAL_FLOAT(other.y), REAL_FLOAT(asteroid.x),
+							 REAL_FLOAT(asteroid.y));
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Sums up the state of the game, so that two builds can be checked to play the same game.
+ *
+ * @param game The game to sum up
+ * @return Checksum of the level, the ship, every asteroid and every bullet
+ */
+static Uint64 soak_checksum(Game *game)
+{
+	Uint64 hash = 0xcbf29ce484222325ULL;
+	Bullet *bullets = game->bullets.items;
+
+	soak_hash(&hash, &game->level, sizeof(game->level));
+	soak_hash(&hash, &game->player->x, sizeof(Real));
+	soak_hash(&hash, &game->player->y, sizeof(Real));
+	soak_hash(&hash, &game->player->direction, sizeof(game->player->direction));
+	/* Field by field, padding isn't part of the state */
+	for (int i = 0; i < game->asteroids.count; i++) {
+		Asteroid asteroid = asteroid_get(game, i);
+		soak_hash(&hash, &asteroid.x, sizeof(Real));
+		soak_hash(&hash, &asteroid.y, sizeof(Real));
+		soak_hash(&hash, &asteroid.radius, sizeof(Real));
+		soak_hash(&hash, &asteroid.dx, sizeof(Real));
+		soak_hash(&hash, &asteroid.dy, sizeof(Real));
+	}
+	for (int i = 0; i < game->bullets.count; i++) {
+		soak_hash(&hash, &bullets[i], sizeof(Bullet));
+	}
+	return hash;
+}
+
+bool soak_run(Uint64 seed, Uint64 ticks)
+{
+	Game *game;
+	Uint64 rng = seed;
+	Uint64 start, last_report, now;
+	Uint64 tick;
+	QueryIndex index;
+	Stats stats;
+	Uint64 counts[EVENT_TYPES] = { 0 };
+	int reader;
+	bool ok = true;
+
+	if (!game_init(&game)) {
+		SDL_Log("Couldn't initialize game");
+		return false;
+	}
+	if (!query_init(&index, game)) {
+		game_free(game);
+		return false;
+	}
+	/* Events are read here every tick, and by the statistics thread at its own pace */
+	reader = events_join(&game->events);
+	if (!stats_start(&stats, &game->events)) {
+		query_free(&index);
+		game_free(game);
+		return false;
+	}
+	/* game_init seeds with the time, we want this run to be reproducible */
+	srand((unsigned int)seed);
+
+	SDL_Log("soak: %llu ticks with seed %llu", (unsigned long long)ticks,
+			(unsigned long long)seed);
+
+	start = last_report = SDL_GetPerformanceCounter();
+	for (tick = 0; tick < ticks; tick++) {
+		Uint64 tick_start = SDL_GetTicksNS();
+		if (SDL_rand_r(&rng, SOAK_RESIZE_CHANCE) == 0) {
+			soak_resize(game, &rng);
+		}
+		game->time = (tick + 1) * (SDL_NS_PER_SECOND / FPS);
+		soak_input(game, &rng);
+		bool ticked = game->state == PLAY;
+		/* A wave spawns first thing in a tick, before the ship moves */
+		Real ship_x = game->player->x;
+		Real ship_y = game->player->y;
+		if (ticked) {
+			game_update_frame(game);
+		}
+		query_update(&index, game);
+
+		Uint64 waves = counts[EVENT_LEVEL];
+		if (!soak_check(game) || !soak_check_queries(game, &index)
+			|| !soak_check_events(game, reader, ticked, counts)
+			|| (counts[EVENT_LEVEL] != waves && !soak_check_wave(game, ship_x, ship_y))) {
+			SDL_Log("soak: invariant violated at tick %llu (level %u, window %dx%d): %s",
+					(unsigned long long)tick, game->level, game->width, game->height, violation);
+			SDL_Log("soak: reproduce with --soak %llu --seed %llu", (unsigned long long)tick + 1,
+					(unsigned long long)seed);
+			ok = false;
+			break;
+		}
+		telemetry_frame(game, tick_start);
+
+		if ((tick + 1) % SOAK_REPORT_INTERVAL == 0) {
+			now = SDL_GetPerformanceCounter();
+			SDL_Log("soak: %llu ticks, %.0f ticks/s", (unsigned long long)tick + 1,
+					(double)SOAK_REPORT_INTERVAL * SDL_GetPerformanceFrequency()
+					  / (double)(now - last_report));
+			last_report = now;
+		}
+	}
+
+	now = SDL_GetPerformanceCounter();
+	SDL_Log("soak: %llu ticks in %.2f s, %.0f ticks/s", (unsigned long long)tick,
+			(double)(now - start) / SDL_GetPerformanceFrequency(),
+			(double)tick * SDL_GetPerformanceFrequency() / (double)(now - start + 1));
+	SDL_Log("soak: state checksum %016llx", (unsigned long long)soak_checksum(game));
+
+	/* Both readers saw every event the game didn't drop */
+	stats_stop(&stats);
+	if (ok && SDL_memcmp(stats.counts, counts, sizeof(counts)) != 0) {
+		SDL_Log("soak: the statistics thread read other events than the soak test");
+		ok = false;
+	}
+
+	query_free(&index);
+	game_free(game);
+	return ok;
+}
+
+/**
+ * What the query jobs of the benchmark share.
+ */
+typedef struct {
+	QueryIndex* index;	/**< Index to query */
+	int world_width;	/**< Width of the world the queries are in */
+	int world_height;	/**< Height of the world the queries are in */
+	SDL_AtomicInt hits; /**< Asteroids found, so that the queries aren't optimized away */
+} BenchQueries;
+
+/**
+ * Runs queries from random points of the world, as bots would, each job on a snapshot of its own.
+ *
+ * @param data The BenchQueries
+ * @param begin First query
+ * @param end One past the last query
+ */
+static void bench_queries(void *data, int begin, int end)
+{
+	BenchQueries *bench = data;
+	const QuerySnapshot *snapshot = query_acquire(bench->index);
+	QueryHit hits[SOAK_QUERY_NEAREST];
+	Uint64 rng = (Uint64)begin;
+	int found = 0;
+
+	for (int i = begin; i < end; i++) {
+		Real x = REAL(SDL_rand_r(&rng, bench->world_width));
+		Real y = REAL(SDL_rand_r(&rng, bench->world_height));
+		unsigned int direction = SDL_rand_r(&rng, 360);
+
+		/* What's closest, what's around and what's ahead, in turn */
+		switch (i % 3) {
+		case 0:
+			found += query_nearest(snapshot, x, y, SOAK_QUERY_NEAREST, hits);
+			break;
+		case 1:
+			found += query_radius(snapshot, x, y, REAL(SOAK_QUERY_REACH), SOAK_QUERY_NEAREST,
+								  hits);
+			break;
+		default:
+			found += query_ray(snapshot, x, y, real_sin(direction), -real_cos(direction),
+							   REAL(SOAK_QUERY_REACH), hits);
+			break;
+		}
+	}
+	query_release(bench->index, snapshot);
+	SDL_AddAtomicInt(&bench->hits, found);
+}
+
+bool soak_bench(Uint64 seed, int n_asteroids, Uint64 ticks)
+{
+	Game *game;
+	QueryIndex index;
+	BenchQueries bench;
+	JobGraph graph;
+	Uint64 start, now, build_time, tick_time = 0, index_time = 0;
+
+	n_asteroids = SDL_max(n_asteroids, 1);
+	/* Same area per asteroid as a full level, same shape as the default world */
+	double area = (double)WORLD_WIDTH * WORLD_HEIGHT / ASTEROID_CAPACITY * n_asteroids;
+	int world_width = (int)SDL_sqrt(area * WORLD_WIDTH / WORLD_HEIGHT);
+	int world_height = (int)(area / world_width);
+
+	/* Room for every one of them to split */
+	if (!game_init_field(&game, world_width, world_height, 2 * n_asteroids)) {
+		SDL_Log("Couldn't initialize game");
+		return false;
+	}
+	if (!query_init(&index, game)) {
+		game_free(game);
+		return false;
+	}
+	srand((unsigned int)seed);
+
+	for (int i = 0; i < n_asteroids; i++) {
+		int radius
+		  = rand() % (ASTEROID_RADIUS_MAX - ASTEROID_RADIUS_MIN + 1) + ASTEROID_RADIUS_MIN;
+		Asteroid asteroid = {
+			.radius = REAL(radius),
+			.x = REAL(radius + rand() % (world_width - 2 * radius)),
+			.y = REAL(radius + rand() % (world_height - 2 * radius)),
+			.dx = REAL((rand() % (ASTEROID_SPEED_MAX - ASTEROID_SPEED_MIN + 1) + ASTEROID_SPEED_MIN)
+					   * (rand() % 2 ? 1 : -1)),
+			.dy = REAL((rand() % (ASTEROID_SPEED_MAX - ASTEROID_SPEED_MIN + 1) + ASTEROID_SPEED_MIN)
+					   * (rand() % 2 ? 1 : -1)),
+		};
+		asteroid_create(game, &asteroid);
+	}
+	store_commit(&game->asteroids);
+	/* Out of the way, it would crash into the field every other tick */
+	game->player->x = 0;
+	game->player->y = 0;
+
+	SDL_Log("bench: %d asteroids in a %dx%d world, %d ticks on %d threads", n_asteroids,
+			world_width, world_height, (int)ticks, jobs_threads());
+	/* What the store keeps of each one, against an unpacked one */
+	SDL_Log("bench: %d bytes per asteroid, %d unpacked, %.1f MiB in all",
+			(int)sizeof(AsteroidData), (int)sizeof(Asteroid),
+			(double)sizeof(AsteroidData) * game->asteroids.count / (1 << 20));
+
+	/* From scratch once, then kept up to date */
+	start = SDL_GetPerformanceCounter();
+	query_update(&index, game);
+	build_time = SDL_GetPerformanceCounter() - start;
+
+	for (Uint64 tick = 0; tick < ticks; tick++) {
+		game->state = PLAY;
+		start = SDL_GetPerformanceCounter();
+		game_update_frame(game);
+		now = SDL_GetPerformanceCounter();
+		tick_time += now - start;
+		query_update(&index, game);
+		index_time += SDL_GetPerformanceCounter() - now;
+	}
+
+	SDL_Log("bench: %.3f ms per tick, %.0f ticks per second",
+			(double)tick_time * 1000 / SDL_GetPerformanceFrequency() / (double)ticks,
+			(double)ticks * SDL_GetPerformanceFrequency() / (double)SDL_max(tick_time, 1));
+	SDL_Log("bench: %d asteroids left, state checksum %016llx", game->asteroids.count,
+			(unsigned long long)soak_checksum(game));
+
+	/* Against the last snapshot, from every thread */
+	bench.index = &index;
+	bench.world_width = world_width;
+	bench.world_height = world_height;
+	SDL_SetAtomicInt(&bench.hits, 0);
+	jobs_graph_init(&graph);
+	jobs_stage(&graph, "queries", bench_queries, &bench, BENCH_QUERIES, BENCH_QUERIES_PER_JOB, 0);
+	start = SDL_GetPerformanceCounter();
+	jobs_run(&graph);
+	now = SDL_GetPerformanceCounter();
+
+	SDL_Log("bench: index built in %.3f ms, updated in %.3f ms per tick",
+			(double)build_time * 1000 / SDL_GetPerformanceFrequency(),
+			(double)index_time * 1000 / SDL_GetPerformanceFrequency() / (double)ticks);
+	SDL_Log("bench: %d queries on %d threads, %.3f us each, %d asteroids found", BENCH_QUERIES,
+			jobs_threads(),
+			(double)(now - start) * 1000000 / SDL_GetPerformanceFrequency() / BENCH_QUERIES,
+			SDL_GetAtomicInt(&bench.hits));
+
+	query_free(&index);
+	game_free(game);
+	return true;
+}
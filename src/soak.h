@@ -0,0 +1,46 @@
+#ifndef SOAK_H
+#define SOAK_H
+
+#include <stdbool.h>
+
+#include <SDL3/SDL_stdinc.h>
+
+/**
+ * Ticks a soak run lasts when no count is given
+ */
+#define SOAK_TICKS 10000000
+/**
+ * Asteroids a benchmark spawns when no count is given
+ */
+#define BENCH_ASTEROIDS 50000
+/**
+ * Ticks a benchmark lasts
+ */
+#define BENCH_TICKS 1000
+
+/**
+ * Runs the game headless for a number of ticks, driving it with random inputs and random resizes,
+ * and checks the game invariants after every tick.
+ *
+ * On failure the seed and tick needed to reproduce it are logged. The sustained tick rate is
+ * logged periodically and at the end.
+ *
+ * @param seed Seed for both the game and the input generator
+ * @param ticks Number of ticks to run
+ * @return True if every invariant held for the whole run, false otherwise
+ */
+bool soak_run(Uint64 seed, Uint64 ticks);
+
+/**
+ * Times the game on a field of many asteroids, in a world as crowded as the busiest level. The
+ * ship sits still in a corner. The time per tick and a checksum of the final state are logged,
+ * the checksum must not depend on the number of threads.
+ *
+ * @param seed Seed for the field
+ * @param asteroids Number of asteroids to spawn
+ * @param ticks Number of ticks to run
+ * @return True if it ran, false if the game couldn't be created
+ */
+bool soak_bench(Uint64 seed, int asteroids, Uint64 ticks);
+
+#endif	// !SOAK_H
@@ -0,0 +1,93 @@
+#include "stats.h"
+
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_timer.h>
+
+/**
+ * Logs what was counted so far.
+ */
+static void stats_log(const Stats *stats, const char *when)
+{
+	Uint64 shots = stats->counts[EVENT_SHOT];
+	Uint64 hits = stats->counts[EVENT_HIT];
+
+	SDL_Log("stats: %s tick %llu, level %u: %llu shots, %llu hits (%.0f%%), %llu splits, "
+			"%llu destroyed, %llu crashes, %llu levels",
+			when, (unsigned long long)stats->tick, stats->level, (unsigned long long)shots,
+			(unsigned long long)hits, (shots > 0) ? 100.0 * (double)hits / (double)shots : 0.0,
+			(unsigned long long)stats->counts[EVENT_SPLIT],
+			(unsigned long long)stats->counts[EVENT_DESTROYED],
+			(unsigned long long)stats->counts[EVENT_CRASH],
+			(unsigned long long)stats->counts[EVENT_LEVEL]);
+}
+
+/**
+ * Reads and counts events until told to stop, and then those still in the ring.
+ */
+static int SDLCALL stats_reader(void *data)
+{
+	Stats *stats = data;
+	GameEvent events[STATS_BATCH];
+	Uint64 last_report = SDL_GetTicks();
+
+	for (;;) {
+		/* Checked before reading, so that what was published before stopping is all read */
+		bool stopping = SDL_GetAtomicInt(&stats->stopping);
+		int n = events_read(stats->ring, stats->reader, events, STATS_BATCH);
+
+		for (int i = 0; i < n; i++) {
+			stats->counts[events[i].type]++;
+			stats->tick = events[i].tick;
+			stats->level = events[i].level;
+		}
+		if (SDL_GetTicks() - last_report >= STATS_INTERVAL) {
+			stats_log(stats, "at");
+			last_report = SDL_GetTicks();
+		}
+		if (n == 0) {
+			if (stopping) {
+				break;
+			}
+			SDL_Delay(STATS_POLL);
+		}
+	}
+
+	return 0;
+}
+
+bool stats_start(Stats *stats, EventRing *ring)
+{
+	SDL_zerop(stats);
+	stats->ring = ring;
+	stats->reader = events_join(ring);
+	if (stats->reader == -1) {
+		SDL_Log("Couldn't read the game events: too many readers");
+		return false;
+	}
+	SDL_SetAtomicInt(&stats->stopping, 0);
+
+	stats->thread = SDL_CreateThread(stats_reader, "stats", stats);
+	if (!stats->thread) {
+		SDL_Log("Couldn't create stats thread: %s", SDL_GetError());
+		return false;
+	}
+
+	return true;
+}
+
+void stats_stop(Stats *stats)
+{
+	if (!stats->thread) {
+		return;
+	}
+	SDL_SetAtomicInt(&stats->stopping, 1);
+	SDL_WaitThread(stats->thread, NULL);
+	stats->thread = NULL;
+
+	stats_log(stats, "done after");
+	/* The game is the only one counting drops, and it is the calling thread */
+	if (stats->ring->dropped > 0) {
+		SDL_Log("stats: %llu events dropped, the ring was full",
+				(unsigned long long)stats->ring->dropped);
+	}
+}
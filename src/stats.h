@@ -0,0 +1,62 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+
+#include <SDL3/SDL_atomic.h>
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_thread.h>
+
+#include "events.h"
+
+/**
+ * Keeps statistics on the game from a thread of its own, reading its events: shots, hits and
+ * accuracy, splits, asteroids destroyed, crashes and levels. They are logged every STATS_INTERVAL
+ * and once more when stopping, along with the events the game had to drop.
+ */
+
+/**
+ * @brief Milliseconds between two reports
+ */
+#define STATS_INTERVAL 1000
+/**
+ * @brief Milliseconds the thread sleeps when there is nothing to read
+ */
+#define STATS_POLL 10
+/**
+ * @brief Events read at a time
+ */
+#define STATS_BATCH 256
+
+/**
+ * Statistics being kept.
+ */
+typedef struct {
+	EventRing* ring;			/**< Ring of the game */
+	int reader;					/**< Reader of the ring it joined as */
+	SDL_Thread* thread;			/**< Thread reading the events, NULL if not started */
+	SDL_AtomicInt stopping;		/**< Whether the thread stops once it read everything */
+	Uint64 counts[EVENT_TYPES]; /**< Events of each kind read, only touched by the thread */
+	Uint64 tick;				/**< Tick of the last event read */
+	unsigned int level;			/**< Level of the last event read */
+} Stats;
+
+/**
+ * Joins the events of a game and starts the thread reading them. Called from the thread running
+ * the game, between ticks.
+ *
+ * @param stats The statistics to start
+ * @param ring Events of the game
+ * @return True if it started, false otherwise
+ */
+bool stats_start(Stats *stats, EventRing *ring);
+
+/**
+ * Reads the last events, stops the thread and logs the totals. Does nothing if it wasn't started.
+ * Called from the thread running the game.
+ *
+ * @param stats The statistics to stop
+ */
+void stats_stop(Stats *stats);
+
+#endif	// !STATS_H
@@ -0,0 +1,162 @@
+#include "store.h"
+
+#include <stdlib.h>
+
+#include <SDL3/SDL_log.h>
+
+/**
+ * @brief Generations wrap around after this many, skipping 0 so no handle is HANDLE_NONE
+ */
+#define GENERATION_MASK ((1u << (32 - HANDLE_SLOT_BITS)) - 1)
+
+/**
+ * Address of an entity in an array of them.
+ */
+static inline void *item_at(const Store *store, void *items, int index)
+{
+	return (char *)items + (size_t)index * store->item_size;
+}
+
+bool store_init(Store *store, size_t item_size, int capacity)
+{
+	SDL_zerop(store);
+	if (capacity <= 0 || capacity > STORE_MAX_CAPACITY) {
+		SDL_Log("Invalid store capacity %d", capacity);
+		return false;
+	}
+
+	store->capacity = capacity;
+	store->item_size = item_size;
+	store->items = malloc(capacity * item_size);
+	store->handles = malloc(capacity * sizeof(Handle));
+	store->dead = calloc(capacity, sizeof(bool));
+	store->slots = malloc(capacity * sizeof(int));
+	store->generations = malloc(capacity * sizeof(Uint32));
+	store->free_slots = malloc(capacity * sizeof(int));
+	store->created = malloc(capacity * item_size);
+	store->created_handles = malloc(capacity * sizeof(Handle));
+	if (!store->items || !store->handles || !store->dead || !store->slots || !store->generations
+		|| !store->free_slots || !store->created || !store->created_handles) {
+		SDL_Log("Couldn't allocate memory: %s", SDL_GetError());
+		store_free(store);
+		return false;
+	}
+
+	/* Slot 0 is handed out first */
+	for (int slot = 0; slot < capacity; slot++) {
+		store->slots[slot] = -1;
+		store->generations[slot] = 1;
+		store->free_slots[slot] = capacity - 1 - slot;
+	}
+	store->n_free = capacity;
+
+	return true;
+}
+
+void store_free(Store *store)
+{
+	free(store->items);
+	free(store->handles);
+	free(store->dead);
+	free(store->slots);
+	free(store->generations);
+	free(store->free_slots);
+	free(store->created);
+	free(store->created_handles);
+	SDL_zerop(store);
+}
+
+Handle store_create(Store *store, const void *item)
+{
+	if (store->n_free == 0) {
+		return HANDLE_NONE;
+	}
+
+	int slot = store->free_slots[--store->n_free];
+	Handle handle = (store->generations[slot] << HANDLE_SLOT_BITS) | slot;
+	SDL_memcpy(item_at(store, store->created, store->n_created), item, store->item_size);
+	store->created_handles[store->n_created++] = handle;
+
+	return handle;
+}
+
+void store_destroy(Store *store, int index)
+{
+	if (!store->dead[index]) {
+		store->dead[index] = true;
+		store->n_dead++;
+	}
+}
+
+int store_find(Store *store, Handle handle)
+{
+	int slot = handle & (STORE_MAX_CAPACITY - 1);
+
+	if (handle == HANDLE_NONE || slot >= store->capacity
+		|| store->generations[slot] != handle >> HANDLE_SLOT_BITS) {
+		return -1;
+	}
+	return store->slots[slot];
+}
+
+/**
+ * Gives a slot back, invalidating every handle to it.
+ */
+static void release_slot(Store *store, Handle handle)
+{
+	int slot = handle & (STORE_MAX_CAPACITY - 1);
+
+	store->slots[slot] = -1;
+	store->generations[slot] = (store->generations[slot] + 1) & GENERATION_MASK;
+	if (store->generations[slot] == 0) {
+		store->generations[slot] = 1;
+	}
+	store->free_slots[store->n_free++] = slot;
+}
+
+void store_commit(Store *store)
+{
+	int count = 0;
+
+	if (store->n_dead > 0) {
+		for (int i = 0; i < store->count; i++) {
+			if (store->dead[i]) {
+				store->dead[i] = false;
+				release_slot(store, store->handles[i]);
+				continue;
+			}
+			if (i != count) {
+				SDL_memcpy(item_at(store, store->items, count), item_at(store, store->items, i),
+						   store->item_size);
+				store->handles[count] = store->handles[i];
+			}
+			store->slots[store->handles[count] & (STORE_MAX_CAPACITY - 1)] = count;
+			count++;
+		}
+		store->count = count;
+		store->n_dead = 0;
+	}
+
+	SDL_memcpy(item_at(store, store->items, store->count), store->created,
+			   store->n_created * store->item_size);
+	for (int i = 0; i < store->n_created; i++) {
+		Handle handle = store->created_handles[i];
+		store->handles[store->count] = handle;
+		store->slots[handle & (STORE_MAX_CAPACITY - 1)] = store->count++;
+	}
+	store->n_created = 0;
+}
+
+void store_clear(Store *store)
+{
+	for (int i = 0; i < store->count; i++) {
+		store->dead[i] = false;
+		release_slot(store, store->handles[i]);
+	}
+	for (int i = 0; i < store->n_created; i++) {
+		release_slot(store, store->created_handles[i]);
+	}
+	store->count = 0;
+	store->n_dead = 0;
+	store->n_created = 0;
+}
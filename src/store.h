@@ -0,0 +1,138 @@
+#ifndef STORE_H
+#define STORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <SDL3/SDL_stdinc.h>
+
+/**
+ * Dense storage for one kind of entity, addressed by generational handles.
+ *
+ * Creations and destructions requested during a frame are deferred. Until store_commit() the
+ * dense array keeps its order and length, so systems can iterate it, and other code can hold
+ * indices or handles into it, while entities come and go.
+ */
+
+/**
+ * Refers to an entity for as long as it exists. Once it is destroyed the handle stays invalid,
+ * even if its slot is reused.
+ */
+typedef Uint32 Handle;
+
+/**
+ * @brief Handle that never refers to an entity
+ */
+#define HANDLE_NONE 0
+/**
+ * @brief Bits of a handle used for the slot, the rest are the generation
+ */
+#define HANDLE_SLOT_BITS 20
+/**
+ * @brief Maximum capacity of a store
+ */
+#define STORE_MAX_CAPACITY (1 << HANDLE_SLOT_BITS)
+
+/**
+ * A store. Its fields are read only outside store.c, except for the contents of items.
+ */
+typedef struct {
+	void* items;			 /**< Dense entities, the first count are in use */
+	int count;				 /**< Entities in use, including those destroyed this frame */
+	int capacity;			 /**< Maximum number of entities, counting pending ones */
+	size_t item_size;		 /**< Size of one entity */
+	Handle* handles;		 /**< Handle of every dense entity */
+	bool* dead;				 /**< Whether every dense entity was destroyed this frame */
+	int n_dead;				 /**< Entities destroyed this frame */
+	int* slots;				 /**< Dense index of every slot, -1 if free or not committed yet */
+	Uint32* generations;	 /**< Current generation of every slot */
+	int* free_slots;		 /**< Unused slots, the last one is reused first */
+	int n_free;				 /**< Number of unused slots */
+	void* created;			 /**< Entities created this frame, waiting for store_commit() */
+	Handle* created_handles; /**< Handles given to the entities created this frame */
+	int n_created;			 /**< Entities created this frame */
+} Store;
+
+/**
+ * Allocates an empty store.
+ *
+ * @param store The store to initialize
+ * @param item_size Size of one entity
+ * @param capacity Maximum number of entities, at most STORE_MAX_CAPACITY
+ * @return True if the store was allocated, false otherwise
+ */
+bool store_init(Store *store, size_t item_size, int capacity);
+
+/**
+ * Frees everything the store allocated.
+ *
+ * @param store The store to free
+ */
+void store_free(Store *store);
+
+/**
+ * Creates an entity. It is added at the end of the dense array on the next store_commit().
+ *
+ * @param store The store to add to
+ * @param item The entity, copied
+ * @return Handle of the new entity, HANDLE_NONE if the store is full
+ */
+Handle store_create(Store *store, const void *item);
+
+/**
+ * Destroys a dense entity. It stays in the dense array until the next store_commit(), and
+ * destroying it again does nothing.
+ *
+ * @param store The store
+ * @param index Dense index of the entity
+ */
+void store_destroy(Store *store, int index);
+
+/**
+ * Finds an entity from its handle.
+ *
+ * @param store The store
+ * @param handle Handle of the entity
+ * @return Dense index of the entity, -1 if it was destroyed or isn't committed yet
+ */
+int store_find(Store *store, Handle handle);
+
+/**
+ * Applies the creations and destructions of the frame in one pass. Surviving entities keep
+ * their relative order, and created ones go after them in the order they were created.
+ *
+ * @param store The store to compact
+ */
+void store_commit(Store *store);
+
+/**
+ * Destroys every entity right away, including pending ones. Their handles become invalid.
+ *
+ * @param store The store to empty
+ */
+void store_clear(Store *store);
+
+/**
+ * Checks whether a dense entity is still alive, that is, it wasn't destroyed this frame.
+ *
+ * @param store The store
+ * @param index Dense index of the entity
+ * @return True if it is alive
+ */
+static inline bool store_alive(const Store *store, int index)
+{
+	return !store->dead[index];
+}
+
+/**
+ * Number of entities that can still be created this frame.
+ *
+ * @param store The store
+ * @return Free room in the store
+ */
+static inline int store_room(const Store *store)
+{
+	return store->n_free;
+}
+
+#endif	// !STORE_H
@@ -0,0 +1,156 @@
+#include "telemetry.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_timer.h>
+
+/**
+ * The segment, NULL while closed
+ */
+static TelemetrySegment *segment = NULL;
+/**
+ * Name of the segment, after the process id
+ */
+static char name[TELEMETRY_NAME_SIZE];
+/**
+ * Cost of the last frames, in ns, at their number modulo TELEMETRY_FRAMES
+ */
+static Uint64 costs[TELEMETRY_FRAMES];
+/**
+ * Frames recorded
+ */
+static Uint64 frames;
+/**
+ * When the counters were last published
+ */
+static Uint64 last_publish;
+/**
+ * Tick of the game when the counters were last published
+ */
+static Uint64 last_tick;
+
+/**
+ * Orders frame costs, for SDL_qsort().
+ */
+static int compare_costs(const void *a, const void *b)
+{
+	Uint64 first = *(const Uint64 *)a;
+	Uint64 second = *(const Uint64 *)b;
+
+	return (first > second) - (first < second);
+}
+
+/**
+ * Writes the counters, readers retry until the sequence is even and the same on both sides.
+ */
+static void telemetry_publish(const TelemetryCounters *counters)
+{
+	Uint32 sequence = SDL_GetAtomicU32(&segment->sequence);
+
+	SDL_SetAtomicU32(&segment->sequence, sequence + 1);
+	/* Odd before any counter changes */
+	SDL_MemoryBarrierRelease();
+	segment->counters = *counters;
+	/* Every counter changed before it is even again */
+	SDL_MemoryBarrierRelease();
+	SDL_SetAtomicU32(&segment->sequence, sequence + 2);
+}
+
+bool telemetry_open(void)
+{
+	SDL_snprintf(name, sizeof(name), TELEMETRY_NAME, (int)getpid());
+	int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+
+	if (fd == -1) {
+		SDL_Log("Couldn't create shared memory %s", name);
+		return false;
+	}
+	if (ftruncate(fd, sizeof(TelemetrySegment)) == -1) {
+		SDL_Log("Couldn't size shared memory %s", name);
+		close(fd);
+		shm_unlink(name);
+		return false;
+	}
+	segment = mmap(NULL, sizeof(TelemetrySegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	/* The mapping stays once the descriptor is closed */
+	close(fd);
+	if (segment == MAP_FAILED) {
+		SDL_Log("Couldn't map shared memory %s", name);
+		segment = NULL;
+		shm_unlink(name);
+		return false;
+	}
+
+	/* Left over by a game that crashed with the same process id, it is taken over */
+	telemetry_publish(&(TelemetryCounters){ .running = true });
+	segment->magic = TELEMETRY_MAGIC;
+	frames = 0;
+	last_publish = SDL_GetTicksNS();
+	last_tick = 0;
+	SDL_Log("telemetry: publishing to shared memory %s, watch it with ./monitor %d", name,
+			(int)getpid());
+
+	return true;
+}
+
+void telemetry_frame(Game *game, Uint64 frame_start_ns)
+{
+	if (!segment) {
+		return;
+	}
+	Uint64 now = SDL_GetTicksNS();
+	costs[frames++ % TELEMETRY_FRAMES] = now - frame_start_ns;
+	/*
+	 * Outside of PLAY the game stops iterating until something happens, so a change of state or
+	 * of level can't wait for the next publication, there may not be one.
+	 */
+	bool changed = segment->counters.updates == 0 || segment->counters.state != game->state
+				   || segment->counters.level != game->level;
+	if (!changed && now - last_publish < TELEMETRY_INTERVAL * SDL_NS_PER_MS) {
+		return;
+	}
+
+	/* Sorted on the side, the last frames keep their order */
+	Uint64 sorted[TELEMETRY_FRAMES];
+	int n = (int)SDL_min(frames, TELEMETRY_FRAMES);
+	SDL_memcpy(sorted, costs, n * sizeof(Uint64));
+	SDL_qsort(sorted, n, sizeof(Uint64), compare_costs);
+
+	TelemetryCounters counters = segment->counters;
+	counters.updates++;
+	counters.tick = game->tick;
+	counters.tick_rate = (float)((double)(game->tick - last_tick) * SDL_NS_PER_SECOND
+								 / (double)SDL_max(now - last_publish, 1));
+	counters.frame_p50 = (float)sorted[n / 2] / SDL_NS_PER_MS;
+	counters.frame_p90 = (float)sorted[n * 90 / 100] / SDL_NS_PER_MS;
+	counters.frame_p99 = (float)sorted[n * 99 / 100] / SDL_NS_PER_MS;
+	counters.frame_max = (float)sorted[n - 1] / SDL_NS_PER_MS;
+	counters.n_asteroids = game->asteroids.count;
+	counters.n_bullets = game->bullets.count;
+	counters.pair_tests = SDL_GetAtomicInt(&game->pair_tests);
+	counters.level = game->level;
+	counters.state = game->state;
+	counters.running = true;
+	telemetry_publish(&counters);
+
+	last_publish = now;
+	last_tick = game->tick;
+}
+
+void telemetry_close(void)
+{
+	if (!segment) {
+		return;
+	}
+	TelemetryCounters counters = segment->counters;
+	counters.running = false;
+	telemetry_publish(&counters);
+
+	munmap(segment, sizeof(TelemetrySegment));
+	segment = NULL;
+	/* Readers still mapping it keep it until they let go */
+	shm_unlink(name);
+}
@@ -0,0 +1,92 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+
+#include <SDL3/SDL_atomic.h>
+#include <SDL3/SDL_stdinc.h>
+
+#include "game.h"
+
+/**
+ * Live counters of a running game, for a monitor in another terminal (tools/monitor.c): frame time
+ * percentiles, tick rate, asteroids, bullets, pair tests, level and state.
+ *
+ * With --telemetry the game publishes them into a POSIX shared memory segment of its own, named
+ * after its process id, a few times a second. The segment is guarded by a sequence lock: the game
+ * never waits for readers and doesn't know about them, readers retry whenever they catch it in the
+ * middle of an update. Each frame only records its cost, the rest is done when publishing.
+ */
+
+/**
+ * @brief Name of the shared memory segment of a game, formatted with its process id. There is a
+ * segment per game so that each one is the only writer of its own.
+ */
+#define TELEMETRY_NAME "/asteroid-telemetry-%d"
+/**
+ * @brief Room for a name of a segment, the terminating zero included
+ */
+#define TELEMETRY_NAME_SIZE 48
+/**
+ * @brief First bytes of the segment, "AST" and a version of its layout
+ */
+#define TELEMETRY_MAGIC 0x41535401
+/**
+ * @brief Frames the frame time percentiles are taken over, a power of two
+ */
+#define TELEMETRY_FRAMES 128
+/**
+ * @brief Milliseconds between two publications
+ */
+#define TELEMETRY_INTERVAL 100
+
+/**
+ * What is published.
+ */
+typedef struct {
+	Uint64 updates;		/**< Publications so far */
+	Uint64 tick;		/**< Ticks simulated */
+	float tick_rate;	/**< Ticks per second since the last publication */
+	float frame_p50;	/**< Median frame time over the last TELEMETRY_FRAMES frames, in ms */
+	float frame_p90;	/**< 90th percentile of the frame time, in ms */
+	float frame_p99;	/**< 99th percentile of the frame time, in ms */
+	float frame_max;	/**< Longest frame, in ms */
+	int n_asteroids;	/**< Asteroids alive */
+	int n_bullets;		/**< Bullets alive */
+	int pair_tests;		/**< Asteroid pairs tested for collisions in the last tick */
+	unsigned int level; /**< Current level */
+	GameState state;	/**< State of the game */
+	bool running;		/**< False once the game exited */
+} TelemetryCounters;
+
+/**
+ * The shared memory segment.
+ */
+typedef struct {
+	Uint32 magic;				/**< TELEMETRY_MAGIC once the segment is ready */
+	SDL_AtomicU32 sequence;		/**< Odd while the counters are being written */
+	TelemetryCounters counters; /**< The counters, only valid when read between equal sequences */
+} TelemetrySegment;
+
+/**
+ * Creates the segment of this process and starts publishing into it.
+ *
+ * @return True if it was created, false otherwise
+ */
+bool telemetry_open(void);
+
+/**
+ * Records the cost of a frame, and publishes the counters when it is time, or right away when the
+ * state or the level changed. Does nothing if telemetry isn't open.
+ *
+ * @param game The game
+ * @param frame_start_ns When the frame started, on the SDL_GetTicksNS() clock
+ */
+void telemetry_frame(Game *game, Uint64 frame_start_ns);
+
+/**
+ * Tells readers the game exited, and removes the segment. Does nothing if telemetry isn't open.
+ */
+void telemetry_close(void);
+
+#endif	// !TELEMETRY_H
@@ -0,0 +1,67 @@
+/**
+ * @file bakefont.c
+ * @brief Rasterizes the game font once, into a header with its atlas and metrics.
+ *
+ * Usage: bakefont FONT OUTPUT
+ */
+#include <stdio.h>
+
+#include <SDL3/SDL.h>
+
+#include "font.h"
+
+/**
+ * @brief Bytes written per line of the pixel array
+ */
+#define BYTES_PER_LINE 16
+
+int main(int argc, char *argv[])
+{
+	FontAtlas atlas;
+	FILE *out;
+	int size;
+
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s FONT OUTPUT\n", argv[0]);
+		return 1;
+	}
+	if (!font_rasterize(argv[1], &atlas)) {
+		return 1;
+	}
+
+	out = fopen(argv[2], "w");
+	if (!out) {
+		perror(argv[2]);
+		SDL_free((void *)atlas.pixels);
+		return 1;
+	}
+
+	size = (atlas.width + 7) / 8 * atlas.height;
+	fprintf(out, "/* Generated by bakefont from %s at %d px. Do not edit. */\n\n", argv[1],
+			FONT_SIZE);
+	fprintf(out, "static const Uint8 font_atlas_pixels[%d] = {", size);
+	for (int i = 0; i < size; i++) {
+		fprintf(out, "%s0x%02x,", (i % BYTES_PER_LINE) ? " " : "\n\t", atlas.pixels[i]);
+	}
+	fprintf(out, "\n};\n\n");
+
+	fprintf(out, "static const FontAtlas font_atlas = {\n");
+	fprintf(out, "\t.width = %d,\n\t.height = %d,\n\t.line_height = %d,\n", atlas.width,
+			atlas.height, atlas.line_height);
+	fprintf(out, "\t.glyphs = {\n");
+	for (int i = 0; i < FONT_GLYPHS; i++) {
+		FontGlyph *g = &atlas.glyphs[i];
+		fprintf(out, "\t\t{ %d, %d, %d, %d, %d, %d, %d }, /* '%c' */\n", g->x, g->y, g->w, g->h,
+				g->left, g->top, g->advance, FONT_FIRST_GLYPH + i);
+	}
+	fprintf(out, "\t},\n\t.pixels = font_atlas_pixels,\n};\n");
+
+	SDL_free((void *)atlas.pixels);
+	if (fclose(out) != 0) {
+		perror(argv[2]);
+		return 1;
+	}
+	printf("%s: %d glyphs in a %dx%d atlas, %d bytes\n", argv[2], FONT_GLYPHS, atlas.width,
+		   atlas.height, size);
+	return 0;
+}
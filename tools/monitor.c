@@ -0,0 +1,198 @@
+/**
+ * @file monitor.c
+ * @brief Shows the live counters of a game started with --telemetry, from its shared memory.
+ *
+ * Usage: monitor [PID [INTERVAL_MS]]
+ *
+ * Without a process id, it watches the only game publishing, and lists them when there are several.
+ * It only ever reads the segment, the game doesn't know it is there.
+ */
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <SDL3/SDL.h>
+
+#include "telemetry.h"
+
+/**
+ * @brief Milliseconds between two refreshes when no interval is given
+ */
+#define MONITOR_INTERVAL 500
+/**
+ * @brief Milliseconds without a publication after which a game being played is shown as stalled
+ */
+#define MONITOR_STALLED 2000
+
+/**
+ * @brief Where POSIX shared memory segments show up as files
+ */
+#define MONITOR_SHM_DIR "/dev/shm"
+
+/**
+ * Names of the states of the game
+ */
+static const char *state_names[] = { "menu", "play", "pause", "game over" };
+
+/**
+ * Names a state read from the segment, which may hold anything.
+ */
+static const char *state_name(GameState state)
+{
+	if ((unsigned int)state >= SDL_arraysize(state_names)) {
+		return "unknown";
+	}
+	return state_names[state];
+}
+
+/**
+ * Looks for the games publishing, those whose process is gone are left out.
+ *
+ * @return The process id of the only one, or 0 if there are none or several, listed then
+ */
+static int find_game(void)
+{
+	DIR *dir = opendir(MONITOR_SHM_DIR);
+	struct dirent *entry;
+	int found = 0;
+	int games = 0;
+
+	if (!dir) {
+		perror(MONITOR_SHM_DIR);
+		return 0;
+	}
+	while ((entry = readdir(dir))) {
+		int pid;
+		char name[TELEMETRY_NAME_SIZE];
+
+		/* The name is formatted back, so that only exact matches count */
+		if (sscanf(entry->d_name, TELEMETRY_NAME + 1, &pid) != 1) {
+			continue;
+		}
+		SDL_snprintf(name, sizeof(name), TELEMETRY_NAME, pid);
+		if (SDL_strcmp(name + 1, entry->d_name) != 0 || (kill(pid, 0) == -1 && errno == ESRCH)) {
+			continue;
+		}
+		/* The first one is only listed once there is a second */
+		if (++games == 2) {
+			fprintf(stderr, "Several games are publishing, pick one:\n  ./monitor %d\n", found);
+		}
+		if (games >= 2) {
+			fprintf(stderr, "  ./monitor %d\n", pid);
+		}
+		found = pid;
+	}
+	closedir(dir);
+
+	if (games == 0) {
+		fprintf(stderr, "No game is publishing, start one with --telemetry\n");
+	}
+	return (games == 1) ? found : 0;
+}
+
+/**
+ * Copies the counters, again and again until no update happened in the middle of it.
+ */
+static void read_counters(TelemetrySegment *segment, TelemetryCounters *counters)
+{
+	for (;;) {
+		Uint32 before = SDL_GetAtomicU32(&segment->sequence);
+		if (before & 1) {
+			SDL_CPUPauseInstruction();
+			continue;
+		}
+		/* The copy isn't read before the sequence it is checked against */
+		SDL_MemoryBarrierAcquire();
+		*counters = segment->counters;
+		/* Nor after the sequence it is checked against the second time */
+		SDL_MemoryBarrierAcquire();
+		if (SDL_GetAtomicU32(&segment->sequence) == before) {
+			return;
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int pid = (argc > 1) ? SDL_atoi(argv[1]) : 0;
+	int interval = (argc > 2) ? SDL_atoi(argv[2]) : MONITOR_INTERVAL;
+	char name[TELEMETRY_NAME_SIZE];
+	bool terminal = isatty(STDOUT_FILENO);
+	TelemetrySegment *segment;
+	TelemetryCounters counters;
+	Uint64 last_updates = 0;
+	Uint64 last_change = SDL_GetTicks();
+
+	if (argc > 3 || pid < 0 || interval <= 0) {
+		fprintf(stderr, "Usage: %s [PID [INTERVAL_MS]]\n", argv[0]);
+		return 1;
+	}
+	if (pid == 0 && (pid = find_game()) == 0) {
+		return 1;
+	}
+
+	SDL_snprintf(name, sizeof(name), TELEMETRY_NAME, pid);
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd == -1) {
+		fprintf(stderr, "Game %d isn't publishing, start it with --telemetry\n", pid);
+		return 1;
+	}
+	segment = mmap(NULL, sizeof(TelemetrySegment), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (segment == MAP_FAILED) {
+		perror(name);
+		return 1;
+	}
+	if (segment->magic != TELEMETRY_MAGIC) {
+		fprintf(stderr, "%s isn't the telemetry of this version of the game\n", name);
+		munmap(segment, sizeof(TelemetrySegment));
+		return 1;
+	}
+
+	for (;;) {
+		read_counters(segment, &counters);
+		bool changed = counters.updates != last_updates || !counters.running;
+		if (changed) {
+			last_updates = counters.updates;
+			last_change = SDL_GetTicks();
+		}
+		/* Outside of PLAY the game only publishes when something changes */
+		bool stalled = counters.state == PLAY && SDL_GetTicks() - last_change > MONITOR_STALLED;
+
+		if (terminal) {
+			/* Over the last refresh */
+			printf("\033[H\033[J");
+			printf("state      %s, level %u%s\n", state_name(counters.state), counters.level,
+				   stalled ? " (stalled)" : "");
+			printf("ticks      %llu, %.0f per second\n", (unsigned long long)counters.tick,
+				   counters.tick_rate);
+			printf("frame ms   p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n", counters.frame_p50,
+				   counters.frame_p90, counters.frame_p99, counters.frame_max);
+			printf("entities   %d asteroids, %d bullets\n", counters.n_asteroids,
+				   counters.n_bullets);
+			printf("collisions %d pair tests per tick\n", counters.pair_tests);
+		} else if (changed || stalled) {
+			/* A line per publication when piped */
+			printf("tick %llu %.0f/s frame p50 %.3f p90 %.3f p99 %.3f max %.3f ms, "
+				   "%d asteroids %d bullets %d pairs, level %u %s%s\n",
+				   (unsigned long long)counters.tick, counters.tick_rate, counters.frame_p50,
+				   counters.frame_p90, counters.frame_p99, counters.frame_max,
+				   counters.n_asteroids, counters.n_bullets, counters.pair_tests,
+				   counters.level, state_name(counters.state), stalled ? " stalled" : "");
+		}
+		fflush(stdout);
+
+		if (!counters.running) {
+			printf("The game exited\n");
+			break;
+		}
+		SDL_Delay(interval);
+	}
+
+	munmap(segment, sizeof(TelemetrySegment));
+	return 0;
+}